@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    CurveTable.cpp
+
+  ==============================================================================
+*/
+
+#include "CurveTable.h"
+
+//==============================================================================
+void CurveTable::build()
+{
+    if (isBuilt())
+        return;
+
+    curves.resize(numCurves);
+
+    for (int exponentiation = 0; exponentiation < numCurves; ++exponentiation)
+    {
+        auto& curve = curves[(size_t) exponentiation];
+        auto n = exponentFor(exponentiation);
+
+        curve.n = n;
+        curve.k = pow(n - 1, n - 1) / pow(n, n);
+        curve.threshold = (float) (n / (n - 1));
+        curve.inverseThreshold = (float) ((n - 1) / n);
+        curve.slope = (float) (1.0 / (n - 1));
+
+        curve.clipCurve = ClipCurve(n);
+
+        // table[1 + i] = v^(2n) at v = i / tableSize, with the guard points
+        // taken from the even extension |v|^(2n) and its continuation past 1
+        for (int i = -1; i < tableSize + 2; ++i)
+        {
+            auto v = std::abs((double) i / tableSize);
+            curve.table[(size_t) (i + 1)] = (float) pow(v, 2.0 * n);
+        }
+    }
+}
+
+std::shared_ptr<const CurveTable> CurveTable::getShared (SharedTableStore& store)
+{
+    // the same 101 curves at any sample rate and accuracy, so one key covers them
+    return store.get<CurveTable>({ "4-27 curves" }, []
+    {
+        auto table = std::make_shared<CurveTable>();
+        table->build();
+        return table;
+    });
+}
+
+//==============================================================================
+void CurveTable::process (float* data, int numSamples, int exponentiation, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept
+{
+    processSamples(data, numSamples, exponentiation, accuracy, isa);
+}
+
+void CurveTable::process (double* data, int numSamples, int exponentiation, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept
+{
+    processSamples(data, numSamples, exponentiation, accuracy, isa);
+}
+
+template <typename Sample>
+void CurveTable::processSamples (Sample* data, int numSamples, int exponentiation, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept
+{
+    const auto& curve = curveFor(exponentiation);
+
+    // whole exponents have a compile time curve that beats every table tier
+    if (ClipKernels::forIntegerCurve(curve.n, [&] (auto integerCurve) { ClipKernels::clip(isa, integerCurve, data, numSamples); }))
+        return;
+
+    // the accuracy switch is hoisted out of the loop so each tier gets its own
+    // branch free inner loop, which is compiled once per instruction set
+    switch (accuracy)
+    {
+        case Accuracy::exact:
+            KernelDispatch::forEachSample(isa, numSamples, [&] (int i) { data[i] = evaluate(curve, data[i], Accuracy::exact); });
+            break;
+
+        case Accuracy::high:
+            KernelDispatch::forEachSample(isa, numSamples, [&] (int i) { data[i] = evaluate(curve, data[i], Accuracy::high); });
+            break;
+
+        case Accuracy::fast:
+        default:
+            KernelDispatch::forEachSample(isa, numSamples, [&] (int i) { data[i] = evaluate(curve, data[i], Accuracy::fast); });
+            break;
+    }
+}
+
+void CurveTable::processMorph (float* data, const float* position, int numSamples, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept
+{
+    processMorphSamples(data, position, numSamples, accuracy, isa);
+}
+
+void CurveTable::processMorph (double* data, const float* position, int numSamples, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept
+{
+    processMorphSamples(data, position, numSamples, accuracy, isa);
+}
+
+template <typename Sample>
+void CurveTable::processMorphSamples (Sample* data, const float* position, int numSamples, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept
+{
+    jassert(isBuilt());
+
+    // both curves come from the tables, the pow() of the exact tier on two
+    // curves per sample costs far more than the ramp is worth
+    auto morph = [&] (Accuracy tier)
+    {
+        KernelDispatch::forEachSample(isa, numSamples, [&] (int i)
+        {
+            auto lower = juce::jlimit(0, numCurves - 2, (int) position[i]);
+            auto amount = juce::jlimit((Sample) 0, (Sample) 1, (Sample) (position[i] - (float) lower));
+
+            auto from = evaluate(curves[(size_t) lower], data[i], tier);
+            auto to = evaluate(curves[(size_t) lower + 1], data[i], tier);
+            data[i] = from + amount * (to - from);
+        });
+    };
+
+    if (accuracy == Accuracy::fast)
+        morph(Accuracy::fast);
+    else
+        morph(Accuracy::high);
+}
+
+float CurveTable::processSample (float input, int exponentiation, Accuracy accuracy) const noexcept
+{
+    return evaluate(curveFor(exponentiation), input, accuracy);
+}
+
+const CurveTable::Curve& CurveTable::curveFor (int exponentiation) const noexcept
+{
+    jassert(isBuilt());
+    return curves[(size_t) juce::jlimit(0, numCurves - 1, exponentiation)];
+}
+
+template <typename Sample>
+Sample CurveTable::evaluate (const Curve& curve, Sample input, Accuracy accuracy) noexcept
+{
+    auto magnitude = std::abs(input);
+
+    if (accuracy == Accuracy::exact)
+    {
+        double tmp = magnitude > curve.threshold ? 1.0
+                                                 : magnitude - curve.k * pow((double) magnitude, curve.n);
+        return std::copysign((Sample) tmp, input);
+    }
+
+    auto u = juce::jmin(magnitude * (Sample) curve.inverseThreshold, (Sample) 1);
+    auto position = std::sqrt(u) * (Sample) tableSize;
+    auto index = juce::jmin((int) position, tableSize - 1);
+    auto frac = position - (Sample) index;
+
+    // p points at v = index / tableSize, p[-1] is always valid thanks to the guard point.
+    // The table is float, the interpolation runs in the samples' precision
+    const auto* p = curve.table.data() + 1 + index;
+    Sample p0 = p[0], p1 = p[1], pm1 = p[-1], p2 = p[2];
+    Sample un;
+
+    if (accuracy == Accuracy::fast)
+    {
+        un = p0 + frac * (p1 - p0);
+    }
+    else
+    {
+        // Catmull-Rom
+        auto c1 = (Sample) 0.5 * (p1 - pm1);
+        auto c2 = pm1 - (Sample) 2.5 * p0 + (Sample) 2 * p1 - (Sample) 0.5 * p2;
+        auto c3 = (Sample) 0.5 * (p2 - pm1) + (Sample) 1.5 * (p0 - p1);
+        un = ((c3 * frac + c2) * frac + c1) * frac + p0;
+    }
+
+    // x - k * x^n  ==  threshold * u - u^n / (n - 1)
+    return std::copysign((Sample) curve.threshold * u - (Sample) curve.slope * un, input);
+}
+
+//==============================================================================
+double CurveTable::processSampleReference (double input, double n) noexcept
+{
+    double tmp = input;
+
+    if (tmp > (n / (n - 1))) {
+        tmp = 1;
+    }
+    else if (tmp < -(n / (n - 1))) {
+        tmp = -1;
+    }
+    else if (tmp >= 0 && tmp <= (n / (n - 1))) {
+        tmp = (tmp - ((pow(n - 1, n - 1)) / pow(n, n)) * pow(tmp, n));
+    }
+    else if (tmp <= 0 && tmp >= -(n / (n - 1))) {
+        tmp = (tmp + ((pow(n - 1, n - 1)) / pow(n, n)) * pow(-tmp, n));
+    }
+    else {
+        tmp = 0;
+    }
+
+    return tmp;
+}
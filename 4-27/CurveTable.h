@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    CurveTable.h
+
+    Precomputed curves for the 4-27 variable-exponent clipper.
+
+    The clipper evaluates  y = x - k * |x|^n  (sign mirrored) for |x| below
+    n / (n - 1) and hard clips above it, with  k = (n - 1)^(n - 1) / n^n.
+    Since n only depends on the integer Exponentiation parameter there are
+    only 101 distinct curves, so everything that depends on n is computed
+    once in build() instead of per sample.
+
+    The tables are float, but a curve is evaluated in the precision of the
+    samples given to it, float or double.
+
+    Each curve also comes as a ClipCurve with its first two antiderivatives,
+    for the antialiased clipper in ../Shared/AntiderivativeClipper.h.
+
+    Where n comes out as a whole number (2, 4, 6 and 8) the curve is run
+    with ClipKernels::PowerCurve instead, whatever the accuracy, as a chain
+    of multiplies is both exact and faster than either table.
+
+    Nothing in it depends on the instance or the sample rate, so the
+    processors share one built table through ../Shared/SharedTableStore.h,
+    see getShared().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Shared/ClipKernels.h"
+#include "../Shared/SharedTableStore.h"
+
+//==============================================================================
+class CurveTable
+{
+public:
+    //==============================================================================
+    /** How the curve is evaluated.
+
+        exact   : cached coefficient, std::pow per sample (the reference path)
+        high    : cubic interpolated lookup table
+        fast    : linear interpolated lookup table
+
+        Integer exponents ignore this and always use the exact multiply chain.
+    */
+    enum class Accuracy
+    {
+        exact,
+        high,
+        fast
+    };
+
+    static constexpr int numCurves = 101;
+    static constexpr int tableSize = 512;
+
+    //==============================================================================
+    /** Builds all curves. Allocates, so call it from prepareToPlay. Does nothing
+        once the tables have been built.
+    */
+    void build();
+
+    bool isBuilt() const noexcept { return ! curves.empty(); }
+
+    /** The built table every instance in the process shares, from the store.
+        Builds it if no instance holds one, so call it from prepareToPlay.
+    */
+    static std::shared_ptr<const CurveTable> getShared (SharedTableStore& store);
+
+    /** The bytes the tables take up, for SharedTableStore's stats. */
+    size_t getMemoryUsage() const noexcept   { return sizeof (*this) + curves.capacity() * sizeof (Curve); }
+
+    /** Clips numSamples in place using the curve for the given Exponentiation
+        value, with the loops compiled for isa (see KernelDispatch).
+    */
+    void process (float* data, int numSamples, int exponentiation, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept;
+    void process (double* data, int numSamples, int exponentiation, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept;
+
+    float processSample (float input, int exponentiation, Accuracy accuracy) const noexcept;
+
+    /** Clips numSamples in place on a curve between two neighbouring ones, for
+        while Exponentiation is ramping. position[i] is a fractional
+        Exponentiation value for sample i, and the curves either side of it are
+        crossfaded by how far it is between them. Always runs a table tier,
+        high for exact.
+    */
+    void processMorph (float* data, const float* position, int numSamples, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept;
+    void processMorph (double* data, const float* position, int numSamples, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept;
+
+    //==============================================================================
+    /** One curve in double precision with its antiderivatives, in the form
+        AntiderivativeClipper takes. Evaluated with std::pow, as the tables
+        aren't accurate enough to take differences of.
+    */
+    using ClipCurve = ClipKernels::GenericPowerCurve;
+
+    const ClipCurve& getClipCurve (int exponentiation) const noexcept   { return curveFor(exponentiation).clipCurve; }
+
+    //==============================================================================
+    /** Maps the Exponentiation parameter (0 - 100) to the curve exponent. */
+    static double exponentFor (int exponentiation) noexcept   { return 8.0 * ((exponentiation + 13) / 100.0); }
+
+    /** The original per-sample pow() formulation, kept as the reference the tables are checked against (see the Benchmark tool). */
+    static double processSampleReference (double input, double n) noexcept;
+
+private:
+    //==============================================================================
+    struct Curve
+    {
+        double n = 0.0;
+        double k = 0.0;                 // (n - 1)^(n - 1) / n^n
+        float threshold = 0.0f;         // n / (n - 1), where the curve reaches +-1
+        float inverseThreshold = 0.0f;
+        float slope = 0.0f;             // 1 / (n - 1)
+
+        // u^n sampled on v = sqrt(u), u = |x| / threshold. The square root
+        // warp keeps the table smooth near zero where u^n is not (n < 2).
+        // One guard point before and two after for the cubic interpolation.
+        std::array<float, tableSize + 3> table;
+
+        ClipCurve clipCurve;
+    };
+
+    const Curve& curveFor (int exponentiation) const noexcept;
+
+    template <typename Sample>
+    void processSamples (Sample* data, int numSamples, int exponentiation, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept;
+
+    template <typename Sample>
+    void processMorphSamples (Sample* data, const float* position, int numSamples, Accuracy accuracy, KernelDispatch::Isa isa) const noexcept;
+
+    template <typename Sample>
+    static Sample evaluate (const Curve& curve, Sample input, Accuracy accuracy) noexcept;
+
+    std::vector<Curve> curves;
+
+    //==============================================================================
+    JUCE_LEAK_DETECTOR (CurveTable)
+};
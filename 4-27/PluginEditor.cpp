@@ -1,40 +1,78 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-_427AudioProcessorEditor::_427AudioProcessorEditor (_427AudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
-}
-
-_427AudioProcessorEditor::~_427AudioProcessorEditor()
-{
-}
-
-//==============================================================================
-void _427AudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
-}
-
-void _427AudioProcessorEditor::resized()
-{
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+_427AudioProcessorEditor::_427AudioProcessorEditor (_427AudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p), parameters (p)
+{
+    addAndMakeVisible(parameters);
+    addAndMakeVisible(curveView);
+    addAndMakeVisible(meterView);
+    
+    driveValue = audioProcessor.apvts.getRawParameterValue("Drive");
+    exponentiationValue = audioProcessor.apvts.getRawParameterValue("Exponentiation");
+    
+    audioProcessor.getMeters().setActive(true);
+    
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (720, 420);
+    
+    lastUpdate = juce::Time::getMillisecondCounterHiRes();
+    timerCallback();
+    startTimerHz(frameRate);
+}
+
+_427AudioProcessorEditor::~_427AudioProcessorEditor()
+{
+    stopTimer();
+    audioProcessor.getMeters().setActive(false);
+}
+
+//==============================================================================
+void _427AudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+}
+
+void _427AudioProcessorEditor::resized()
+{
+    auto area = getLocalBounds();
+    parameters.setBounds(area.removeFromLeft(360));
+    meterView.setBounds(area.removeFromRight(120));
+    curveView.setBounds(area);
+}
+
+void _427AudioProcessorEditor::timerCallback()
+{
+    auto now = juce::Time::getMillisecondCounterHiRes();
+    meterView.update(audioProcessor.getMeters(), (now - lastUpdate) * 0.001);
+    lastUpdate = now;
+    
+    auto driveDecibels = driveValue->load(std::memory_order_relaxed);
+    auto exponentiation = juce::roundToInt(exponentiationValue->load(std::memory_order_relaxed));
+    
+    if (driveDecibels != curveDrive || exponentiation != curveExponentiation)
+        updateCurve(driveDecibels, exponentiation);
+}
+
+void _427AudioProcessorEditor::updateCurve (float driveDecibels, int exponentiation)
+{
+    curveDrive = driveDecibels;
+    curveExponentiation = exponentiation;
+    
+    auto gain = juce::Decibels::decibelsToGain(driveDecibels);
+    auto n = CurveTable::exponentFor(exponentiation);
+    
+    curveView.setCurve({ { [gain, n] (float x) { return (float) CurveTable::processSampleReference(x * gain, n); },
+                           juce::Colours::orange, "n = " + juce::String(n, 2) } });
+}
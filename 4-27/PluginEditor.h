@@ -1,33 +1,60 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-/**
-*/
-class _427AudioProcessorEditor  : public juce::AudioProcessorEditor
-{
-public:
-    _427AudioProcessorEditor (_427AudioProcessor&);
-    ~_427AudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-
-private:
-    // This reference is provided as a quick way for your editor to
-    // access the processor object that created it.
-    _427AudioProcessor& audioProcessor;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (_427AudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "../Shared/CurveView.h"
+#include "../Shared/MeterView.h"
+
+//==============================================================================
+/** The parameters, the clip curve at the current Drive and Exponentiation, and
+    the input and output meters.
+
+    The meters come through the processor's LevelMeters and the curve is only
+    redrawn when Drive or Exponentiation has moved, both checked from a timer
+    so nothing here waits on the audio thread.
+*/
+class _427AudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                  private juce::Timer
+{
+public:
+    _427AudioProcessorEditor (_427AudioProcessor&);
+    ~_427AudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    
+    // redraws the curve for the given parameter values
+    void updateCurve(float driveDecibels, int exponentiation);
+    
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    _427AudioProcessor& audioProcessor;
+    
+    juce::GenericAudioProcessorEditor parameters;
+    CurveView curveView;
+    MeterView meterView;
+    
+    std::atomic<float>* driveValue { nullptr };
+    std::atomic<float>* exponentiationValue { nullptr };
+    
+    // what the curve was last drawn with
+    float curveDrive = 0.0f;
+    int curveExponentiation = -1;
+    
+    static constexpr int frameRate = 30;
+    double lastUpdate = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (_427AudioProcessorEditor)
+};
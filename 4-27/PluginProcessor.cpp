@@ -1,241 +1,424 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-_427AudioProcessor::_427AudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
-#endif
-{
-    drive = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Drive"));
-    
-    exponentiation = dynamic_cast<juce::AudioParameterInt*>(apvts.getParameter("Exponentiation"));
-}
-
-_427AudioProcessor::~_427AudioProcessor()
-{
-}
-
-//==============================================================================
-const juce::String _427AudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool _427AudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool _427AudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool _427AudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double _427AudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int _427AudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int _427AudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void _427AudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String _427AudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void _427AudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void _427AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
-    spec.sampleRate = sampleRate;
-    
-    inputDrive.prepare(spec);
-    
-    inputDrive.setRampDurationSeconds(0.05);
-}
-
-void _427AudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool _427AudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void _427AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    // MY SHIT pasihdfosihdfosidhfsoihsodifh
-    
-    auto numSamples = buffer.getNumSamples();
-    
-    float driveParam = drive->get();
-    int exponentiationParam = exponentiation->get();
-    
-    inputDrive.setGainDecibels(driveParam);
-    applyGain(buffer, inputDrive);
-    
-    double n = 8.0 * ((exponentiationParam + 13) / 100.0);
-
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer (channel);
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            double tmp = 0.0;
-            tmp = channelData[sample];
-            
-            if (tmp > (n / (n - 1))) {
-                tmp = 1;
-            }
-            else if (tmp < -(n / (n - 1))) {
-                tmp = -1;
-            }
-            else if (tmp >= 0 && tmp <= (n / (n - 1))) {
-                tmp = (tmp - ((pow(n - 1, n - 1)) / pow(n, n)) * pow(tmp, n));
-            }
-            else if (tmp <= 0 && tmp >= -(n / (n - 1))) {
-                tmp = (tmp + ((pow(n - 1, n - 1)) / pow(n, n)) * pow(-tmp, n));
-            }
-            else {
-                tmp = 0;
-            }
-            
-            buffer.setSample(channel, sample, tmp);
-        }
-    }
-}
-
-//==============================================================================
-bool _427AudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* _427AudioProcessor::createEditor()
-{
-    //return new _427AudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
-}
-
-//==============================================================================
-void _427AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-}
-
-void _427AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-}
-
-juce::AudioProcessorValueTreeState::ParameterLayout _427AudioProcessor::createParameterLayout() {
-    APVTS::ParameterLayout layout;
-    
-    using namespace juce;
-    
-    layout.add(std::make_unique<AudioParameterFloat>("Drive",
-                                                    "Drive",
-                                                    NormalisableRange<float>(0, 24, 0.01f, 1),
-                                                    0));
-    
-    layout.add(std::make_unique<AudioParameterInt>("Exponentiation",
-                                                   "Exponentiation",
-                                                   0,
-                                                   100,
-                                                   50));
-    
-    return layout;
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new _427AudioProcessor();
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+_427AudioProcessor::_427AudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       )
+#endif
+{
+    drive = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Drive"));
+    
+    exponentiation = dynamic_cast<juce::AudioParameterInt*>(apvts.getParameter("Exponentiation"));
+    
+    oversampling = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("Oversampling"));
+    
+    linearPhase = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("LinearPhase"));
+    
+    antialiasing = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("Antialiasing"));
+    
+    apvts.addParameterListener("Drive", this);
+}
+
+_427AudioProcessor::~_427AudioProcessor()
+{
+    apvts.removeParameterListener("Drive", this);
+}
+
+//==============================================================================
+const juce::String _427AudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool _427AudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool _427AudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool _427AudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double _427AudioProcessor::getTailLengthSeconds() const
+{
+    // the oversampling filters are the only thing that rings on after the input stops
+    return getSampleRate() > 0.0 ? latencyReporter.get() / getSampleRate() : 0.0;
+}
+
+int _427AudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int _427AudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void _427AudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const juce::String _427AudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void _427AudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+}
+
+//==============================================================================
+void _427AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = samplesPerBlock;
+    spec.numChannels = getTotalNumOutputChannels();
+    spec.sampleRate = sampleRate;
+    
+    forEachChain([&] (auto& chain)
+    {
+        // every tier is built here so they can be switched between on the audio thread.
+        // It only ever gets one sub-block at a time, so its buffers are sized for that
+        chain.clipOversampler.prepare((int) spec.numChannels, ProcessorHelpers::subBlockSize, *tableStore);
+    });
+    
+    // only built by the first instance to get here, the curves don't depend on the sample rate
+    if (curves == nullptr)
+        curves = CurveTable::getShared(*tableStore);
+    
+    kernelIsa = KernelDispatch::select();
+    
+    // starts where the parameters are, rather than ramping in from nothing
+    driveRamp.reset(sampleRate, 0.05);
+    driveRamp.setCurrentAndTarget(drive->get());
+    exponentiationRamp.reset(sampleRate, 0.05);
+    exponentiationRamp.setCurrentAndTarget((float) exponentiation->get());
+    
+    updateOversampling();
+    latencyReporter.reportNow(latencyReporter.get());
+    antiderivativeClipper.reset();
+    silenceGate.reset();
+    
+    driveChanged = true;
+}
+
+void _427AudioProcessor::releaseResources()
+{
+    // When playback stops, you can use this as an opportunity to free up any
+    // spare memory, etc.
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool _427AudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // any discrete, surround or ambisonic layout up to maxChannels, the
+    // clipper has no per channel state so every channel is treated the same
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || layouts.getMainOutputChannelSet().size() > maxChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void _427AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBuffer(buffer);
+}
+
+void _427AudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBuffer(buffer);
+}
+
+template <typename Sample>
+void _427AudioProcessor::processBuffer (juce::AudioBuffer<Sample>& buffer) noexcept
+{
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    
+    // MY SHIT pasihdfosihdfosidhfsoihsodifh
+    
+    // nothing in here may allocate, lock or make a system call. The curves are
+    // built in prepareToPlay, and if a host calls this before that the block
+    // is passed through rather than building them on the audio thread.
+    jassert(curves != nullptr);
+    
+    if (curves == nullptr)
+        return;
+    
+    stageTimer.beginBlock();
+    
+    // the editor only wants levels while it is open
+    auto metering = meters.isActive();
+    
+    if (metering)
+        meters.measureInput(buffer, totalNumInputChannels);
+    
+    if constexpr (StageTimer::isEnabled())
+        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+            stageTimer.addDenormals(StageTimer::countDenormals(buffer.getReadPointer(channel), buffer.getNumSamples()));
+    
+    auto& chain = getChain<Sample>();
+    
+    // the curve for each exponent is already cached, so all that moves are the ramps
+    auto updateRamps = [this]
+    {
+        if (driveChanged.exchange(false))
+            driveRamp.setTarget(drive->get());
+        
+        exponentiationRamp.setTarget((float) exponentiation->get());
+    };
+    
+    updateRamps();
+    
+    // does nothing unless Oversampling or Linear Phase has moved
+    auto factor = chain.clipOversampler.getFactor();
+    updateOversampling();
+    
+    // the previous inputs are only any use at the same order and rate
+    auto antialiasingParam = antialiasing->getIndex();
+    
+    if (antialiasingParam != antialiasingOrder || factor != chain.clipOversampler.getFactor())
+    {
+        antiderivativeClipper.reset();
+        antialiasingOrder = antialiasingParam;
+    }
+    
+    // an instance whose input has been silent long enough sleeps through the
+    // curves, and wakes on the first block with signal in it
+    auto asleep = silenceGate.skipBlock(SilenceGate::isSilent(buffer, totalNumInputChannels), buffer.getNumSamples());
+    
+    if (asleep)
+    {
+        // the ramps still move on, so waking finds them where they would have been
+        driveRamp.skip(buffer.getNumSamples());
+        exponentiationRamp.skip(buffer.getNumSamples());
+        
+        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+            buffer.clear(channel, 0, buffer.getNumSamples());
+    }
+    else
+    {
+        auto accuracy = curveAccuracy.load();
+        auto channels = juce::dsp::AudioBlock<Sample>(buffer).getSubsetChannelBlock(0, (size_t) totalNumInputChannels);
+        
+        // The block is worked through a sub-block at a time, with Drive and
+        // Exponentiation read again before each. Automation lands within
+        // subBlockSize samples of where the host put it, whatever size of block
+        // the host sends, and the gain, oversampling and curves all run on the
+        // same few samples while they are still in cache.
+        ProcessorHelpers::forEachSubBlock(buffer.getNumSamples(), [&] (int start, int length)
+        {
+            updateRamps();
+            auto block = channels.getSubBlock((size_t) start, (size_t) length);
+            auto oversamplingFactor = chain.clipOversampler.getFactor();
+            
+            {
+                StageTimer::Scope timing (stageTimer, gainStage);
+                
+                // the ramp writes the sub-block's gains in one go, see ParameterRamp.h
+                std::array<float, ProcessorHelpers::subBlockSize> gains;
+                driveRamp.fillGain(kernelIsa, gains.data(), length);
+                
+                for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+                    KernelDispatch::multiply(kernelIsa, block.getChannelPointer(channel), gains.data(), length);
+            }
+            
+            StageTimer::Scope timing (stageTimer, clipStage);
+            
+            // while Exponentiation ramps, the curves run on a stream of fractional
+            // positions between neighbouring curves, at the rate the curves run at.
+            // ADAA needs one curve with its antiderivatives, so there it steps to
+            // the nearest curve every sub-block instead.
+            auto morphing = exponentiationRamp.isRamping() && antialiasingOrder == 0;
+            auto exponentiationParam = juce::roundToInt(exponentiationRamp.getCurrentValue());
+            std::array<float, ProcessorHelpers::subBlockSize * ClipOversampler<Sample>::maxFactor> positions;
+            
+            if (morphing)
+                exponentiationRamp.fill(kernelIsa, positions.data(), length, oversamplingFactor);
+            else
+                exponentiationRamp.skip(length);
+            
+            // only the curves are oversampled, at 1x this is just the curves on every channel
+            chain.clipOversampler.process(block, [&] (int channel, Sample* channelData, int n)
+            {
+                if (morphing)
+                {
+                    jassert(n == length * oversamplingFactor);
+                    curves->processMorph(channelData, positions.data(), n, accuracy, kernelIsa);
+                    return;
+                }
+                
+                if (antialiasingOrder == 0)
+                {
+                    curves->process(channelData, n, exponentiationParam, accuracy, kernelIsa);
+                    return;
+                }
+                
+                // whole exponents get the compile time curve, the rest the pow() one
+                auto adaa = [&] (const auto& curve) { antiderivativeClipper.process(curve, channel, channelData, n, antialiasingOrder); };
+                
+                if (! ClipKernels::forIntegerCurve(CurveTable::exponentFor(exponentiationParam), adaa))
+                    adaa(curves->getClipCurve(exponentiationParam));
+            });
+        });
+    }
+    
+    // once the silence has gone all the way through the oversampling filters and the
+    // drive has stopped ramping, their state is cleared so that waking starts from nothing
+    if (silenceGate.isWaitingToSleep() && ! driveRamp.isRamping()
+         && SilenceGate::isSilent(buffer, totalNumInputChannels))
+    {
+        chain.clipOversampler.reset();
+        antiderivativeClipper.reset();
+        silenceGate.sleep();
+    }
+    
+    stageTimer.endBlock(buffer.getNumSamples(), totalNumInputChannels);
+    
+    if (metering)
+    {
+        meters.measureOutput(buffer, totalNumInputChannels);
+        meters.publish();
+    }
+}
+
+void _427AudioProcessor::updateOversampling()
+{
+    forEachChain([this] (auto& chain) { chain.clipOversampler.select(oversampling->getIndex(), linearPhase->get()); });
+    
+    // called on the audio thread, so the host only hears about it from the message thread
+    latencyReporter.report(isUsingDoublePrecision() ? doubleChain.clipOversampler.getLatencyInSamples()
+                                                    : floatChain.clipOversampler.getLatencyInSamples());
+    
+    // the oversampling filters hold about twice their latency
+    silenceGate.setTailSamples(2 * latencyReporter.get() + ProcessorHelpers::subBlockSize);
+}
+
+//==============================================================================
+bool _427AudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* _427AudioProcessor::createEditor()
+{
+    return new _427AudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void _427AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    // You should use this method to store your parameters in the memory block.
+    // You could do that either as raw data, or use the XML or ValueTree classes
+    // as intermediaries to make it easy to save and load complex data.
+}
+
+void _427AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // You should use this method to restore your parameters from this memory block,
+    // whose contents will have been created by the getStateInformation() call.
+}
+
+void _427AudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // can be called from any thread, the audio thread picks the change up on its next block
+    driveChanged = true;
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout _427AudioProcessor::createParameterLayout() {
+    APVTS::ParameterLayout layout;
+    
+    using namespace juce;
+    
+    layout.add(std::make_unique<AudioParameterFloat>("Drive",
+                                                    "Drive",
+                                                    NormalisableRange<float>(0, 24, 0.01f, 1),
+                                                    0));
+    
+    layout.add(std::make_unique<AudioParameterInt>("Exponentiation",
+                                                   "Exponentiation",
+                                                   0,
+                                                   100,
+                                                   50));
+    
+    // runs the curves at a higher rate so they don't alias, at the cost of some latency
+    layout.add(std::make_unique<AudioParameterChoice>("Oversampling",
+                                                      "Oversampling",
+                                                      ClipOversampler<float>::getTierNames(),
+                                                      0));
+    
+    layout.add(std::make_unique<AudioParameterBool>("LinearPhase",
+                                                    "Linear Phase",
+                                                    false));
+    
+    // cuts aliasing without oversampling, by clipping the average over each sample step
+    layout.add(std::make_unique<AudioParameterChoice>("Antialiasing",
+                                                      "Antialiasing",
+                                                      AntiderivativeClipper<maxChannels>::getOrderNames(),
+                                                      0));
+    
+    return layout;
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+// (left out of the headless tools, which link both processors into one binary)
+#if ! OMNI_HEADLESS
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new _427AudioProcessor();
+}
+#endif
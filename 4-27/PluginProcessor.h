@@ -1,81 +1,180 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-//==============================================================================
-/**
-*/
-class _427AudioProcessor  : public juce::AudioProcessor
-{
-public:
-    //==============================================================================
-    _427AudioProcessor();
-    ~_427AudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-    
-    // VALUE TREE STATE
-    using APVTS = juce::AudioProcessorValueTreeState;
-    static APVTS::ParameterLayout createParameterLayout();
-    
-    APVTS apvts {*this, nullptr, "Parameters", createParameterLayout()};
-
-private:
-    
-    // pointers
-    juce::AudioParameterFloat* drive{ nullptr };
-    juce::AudioParameterInt* exponentiation{ nullptr };
-    
-    juce::dsp::Gain<float> inputDrive;
-    
-    // apply gain method
-    template <typename T, typename U>
-    void applyGain(T& buffer, U& gain)
-    {
-        auto block = juce::dsp::AudioBlock<float>(buffer);
-        auto ctx = juce::dsp::ProcessContextReplacing<float>(block);
-        gain.process(ctx);
-    }
-    
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (_427AudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CurveTable.h"
+#include "../Shared/StageTimer.h"
+#include "../Shared/LevelMeters.h"
+#include "../Shared/SilenceGate.h"
+#include "../Shared/LatencyReporter.h"
+#include "../Shared/ClipOversampler.h"
+#include "../Shared/AntiderivativeClipper.h"
+#include "../Shared/ProcessorHelpers.h"
+#include "../Shared/ParameterRamp.h"
+#include "../Shared/KernelDispatch.h"
+
+//==============================================================================
+/**
+*/
+class _427AudioProcessor  : public juce::AudioProcessor,
+                            private juce::AudioProcessorValueTreeState::Listener
+{
+public:
+    //==============================================================================
+    _427AudioProcessor();
+    ~_427AudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    
+    // the gain, curves and oversampling all run in either precision
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    
+    // VALUE TREE STATE
+    using APVTS = juce::AudioProcessorValueTreeState;
+    static APVTS::ParameterLayout createParameterLayout();
+    
+    APVTS apvts {*this, nullptr, "Parameters", createParameterLayout()};
+    
+    // largest layout the buses accept
+    static constexpr int maxChannels = 16;
+    
+    // selects how the clip curve is evaluated, safe to call from any thread
+    void setCurveAccuracy(CurveTable::Accuracy accuracy) { curveAccuracy.store(accuracy); }
+    CurveTable::Accuracy getCurveAccuracy() const { return curveAccuracy.load(); }
+    
+    // what the last block spent in each stage, only recorded with OMNI_STAGE_TIMING.
+    // Every block is also published to the timer's ring, for one reader thread to drain
+    StageTimer& getStageTimer() { return stageTimer; }
+    
+    // the instruction set the kernels run with, picked in prepareToPlay
+    KernelDispatch::Isa getKernelIsa() const { return kernelIsa; }
+    
+    // input and output levels for the editor, measured only while one is open
+    LevelMeters& getMeters() { return meters; }
+    
+    // on by default, an instance whose input stays silent stops processing until
+    // signal comes back, see SilenceGate.h. Any thread
+    void setSleepEnabled(bool shouldSleep) { silenceGate.setEnabled(shouldSleep); }
+    
+    // whether the last block was skipped, only meaningful on the thread calling processBlock
+    bool isAsleep() const { return silenceGate.isSleeping(); }
+
+private:
+    
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    
+    // both processBlock()s, in the host's precision
+    template <typename Sample>
+    void processBuffer(juce::AudioBuffer<Sample>& buffer) noexcept;
+    
+    // set by the listener whenever Drive moves, and by prepareToPlay
+    std::atomic<bool> driveChanged { true };
+    
+    // Drive in dB, and Exponentiation, which morphs through the curves
+    // between the old value and the new one rather than stepping to it
+    ParameterRamp driveRamp, exponentiationRamp;
+    
+    // pointers
+    juce::AudioParameterFloat* drive{ nullptr };
+    juce::AudioParameterInt* exponentiation{ nullptr };
+    juce::AudioParameterChoice* oversampling{ nullptr };
+    juce::AudioParameterBool* linearPhase{ nullptr };
+    juce::AudioParameterChoice* antialiasing{ nullptr };
+    
+    // the 101 possible clip curves, shared with every other instance and
+    // fetched in prepareToPlay, as are the oversampling filters. Read only
+    // from then on, so no locking
+    juce::SharedResourcePointer<SharedTableStore> tableStore;
+    std::shared_ptr<const CurveTable> curves;
+    std::atomic<CurveTable::Accuracy> curveAccuracy { CurveTable::Accuracy::high };
+    
+    // The oversampling filters, once for each precision, so a double host
+    // never has its audio converted to float. Both are prepared and kept up
+    // to date, the host picks one before prepareToPlay.
+    template <typename Sample>
+    struct Chain
+    {
+        // runs the curves above 1x when Oversampling is on, the drive gain stays at 1x
+        ClipOversampler<Sample> clipOversampler;
+    };
+    
+    Chain<float> floatChain;
+    Chain<double> doubleChain;
+    
+    template <typename Sample>
+    Chain<Sample>& getChain() noexcept
+    {
+        if constexpr (std::is_same_v<Sample, float>)
+            return floatChain;
+        else
+            return doubleChain;
+    }
+    
+    // settings are applied to both chains, fn takes either
+    template <typename Fn>
+    void forEachChain(Fn&& fn)
+    {
+        fn(floatChain);
+        fn(doubleChain);
+    }
+    
+    // switches oversampling tier and passes any change in latency on to the
+    // host from the message thread, see LatencyReporter.h
+    void updateOversampling();
+    
+    // ADAA, 0 for off or the order, and the previous inputs it works from
+    int antialiasingOrder = 0;
+    AntiderivativeClipper<maxChannels> antiderivativeClipper;
+    
+    // chosen once in prepareToPlay and handed to every kernel, see KernelDispatch.h
+    KernelDispatch::Isa kernelIsa = KernelDispatch::Isa::generic;
+    
+    enum Stage { gainStage, clipStage };
+    StageTimer stageTimer { "gain", "clip" };
+    
+    LevelMeters meters;
+    SilenceGate silenceGate;
+    LatencyReporter latencyReporter { *this };
+    
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (_427AudioProcessor)
+};
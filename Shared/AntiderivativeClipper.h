@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    AntiderivativeClipper.h
+
+    Antiderivative anti-aliasing (ADAA) for the clip curves, which cuts most
+    of a clipper's aliasing at the base sample rate with no oversampling.
+
+    Instead of f (x[n]), first order outputs the average of f over the
+    straight line from x[n - 1] to x[n], using the first antiderivative F1:
+
+        y[n] = (F1 (x[n]) - F1 (x[n - 1])) / (x[n] - x[n - 1])
+
+    and second order does the same again one level up, using F2. When two
+    inputs are closer than the tolerance the division is ill-conditioned, so
+    those samples use the limit the formula tends to instead, which is f at
+    the midpoint for first order. First order delays the signal by half a
+    sample and second order by a whole one, neither of which is reported.
+
+    A curve type provides f, F1 and F2 as  double (double) const  members,
+    as the curves in ClipKernels.h do. The samples can be float or double,
+    but everything in between is done in doubles, as F2 differences lose
+    too much to cancellation in floats. Samples are worked through in
+    chunks: one loop evaluates the antiderivatives, another takes the
+    differences, and the rare ill-conditioned samples are patched up
+    afterwards, so the first two loops have no branches and vectorise.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+template <int maxChannels>
+class AntiderivativeClipper
+{
+public:
+    // Off, first order, second order
+    static juce::StringArray getOrderNames()    { return { "Off", "ADAA 1st order", "ADAA 2nd order" }; }
+
+    //==============================================================================
+    /** Forgets the previous inputs, so the next block starts from its own first sample. */
+    void reset() noexcept
+    {
+        for (auto& state : states)
+            state.primed = false;
+    }
+
+    /** Clips numSamples of one channel in place, order being 1 or 2. The curve
+        can change from one call to the next, only the inputs are remembered.
+    */
+    template <typename Curve, typename Sample>
+    void process (const Curve& curve, int channel, Sample* data, int numSamples, int order) noexcept
+    {
+        auto& state = states[(size_t) channel];
+
+        if (numSamples <= 0)
+            return;
+
+        if (! state.primed)
+        {
+            state.x1 = state.x2 = data[0];
+            state.primed = true;
+        }
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            auto length = juce::jmin(chunkSize, numSamples - start);
+
+            if (order >= 2)
+                processSecondOrder(curve, state, data + start, length);
+            else
+                processFirstOrder(curve, state, data + start, length);
+        }
+    }
+
+private:
+    //==============================================================================
+    static constexpr int chunkSize = 64;
+    static constexpr double tolerance = 1.0e-5;
+
+    struct State
+    {
+        double x1 = 0.0, x2 = 0.0;      // x[n - 1], x[n - 2]
+        bool primed = false;
+    };
+
+    static double safeDivisor (double d) noexcept   { return std::abs(d) > tolerance ? d : 1.0; }
+
+    template <typename Curve, typename Sample>
+    static void processFirstOrder (const Curve& curve, State& state, Sample* data, int length) noexcept
+    {
+        // x[0] is the last input of the previous chunk
+        std::array<double, chunkSize + 1> x, F1;
+        x[0] = state.x1;
+
+        for (int i = 0; i < length; ++i)
+            x[(size_t) i + 1] = data[i];
+
+        for (int i = 0; i <= length; ++i)
+            F1[(size_t) i] = curve.F1(x[(size_t) i]);
+
+        for (int i = 0; i < length; ++i)
+            data[i] = (Sample) ((F1[(size_t) i + 1] - F1[(size_t) i]) / safeDivisor(x[(size_t) i + 1] - x[(size_t) i]));
+
+        for (int i = 0; i < length; ++i)
+            if (std::abs(x[(size_t) i + 1] - x[(size_t) i]) <= tolerance)
+                data[i] = (Sample) curve.f(0.5 * (x[(size_t) i + 1] + x[(size_t) i]));
+
+        state.x2 = x[(size_t) length - 1];
+        state.x1 = x[(size_t) length];
+    }
+
+    template <typename Curve, typename Sample>
+    static void processSecondOrder (const Curve& curve, State& state, Sample* data, int length) noexcept
+    {
+        // x[0] and x[1] are the last two inputs of the previous chunk
+        std::array<double, chunkSize + 2> x, F2;
+        std::array<double, chunkSize + 1> D1;      // D1[i] = first divided difference of F2 between x[i] and x[i + 1]
+        x[0] = state.x2;
+        x[1] = state.x1;
+
+        for (int i = 0; i < length; ++i)
+            x[(size_t) i + 2] = data[i];
+
+        for (int i = 0; i < length + 2; ++i)
+            F2[(size_t) i] = curve.F2(x[(size_t) i]);
+
+        for (int i = 0; i <= length; ++i)
+            D1[(size_t) i] = (F2[(size_t) i + 1] - F2[(size_t) i]) / safeDivisor(x[(size_t) i + 1] - x[(size_t) i]);
+
+        for (int i = 0; i <= length; ++i)
+            if (std::abs(x[(size_t) i + 1] - x[(size_t) i]) <= tolerance)
+                D1[(size_t) i] = curve.F1(0.5 * (x[(size_t) i + 1] + x[(size_t) i]));
+
+        for (int i = 0; i < length; ++i)
+            data[i] = (Sample) (2.0 * (D1[(size_t) i + 1] - D1[(size_t) i]) / safeDivisor(x[(size_t) i + 2] - x[(size_t) i]));
+
+        // x[n] close to x[n - 2]: expands around their midpoint instead
+        for (int i = 0; i < length; ++i)
+        {
+            if (std::abs(x[(size_t) i + 2] - x[(size_t) i]) > tolerance)
+                continue;
+
+            auto middle = x[(size_t) i + 1];
+            auto average = 0.5 * (x[(size_t) i + 2] + x[(size_t) i]);
+            auto delta = average - middle;
+
+            data[i] = (Sample) (std::abs(delta) <= tolerance
+                                 ? curve.f(0.5 * (average + middle))
+                                 : 2.0 / delta * (curve.F1(average) + (curve.F2(middle) - curve.F2(average)) / delta));
+        }
+
+        state.x2 = x[(size_t) length];
+        state.x1 = x[(size_t) length + 1];
+    }
+
+    std::array<State, maxChannels> states;
+};
@@ -0,0 +1,318 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.h
+
+    A small pool of helper threads that lets processBlock split its channels
+    into groups and process them in parallel.
+
+    There is one pool for the whole process, held through a
+    juce::SharedResourcePointer, with at most one worker per core past the
+    first. Every instance shares it, so a session full of surround buses
+    never starts more threads than the machine has cores.
+
+    run() never allocates or locks: the task is passed on the caller's stack,
+    and idle workers are handed it through an atomic. The caller runs the
+    first group itself and then claims whatever groups are left along with
+    the workers, so a group nobody picked up is simply run on the audio
+    thread, and the caller only ever waits for a group a worker has already
+    started. With every worker busy for other instances, run() just does all
+    the groups itself.
+
+    The workers are realtime threads. Between jobs a worker spins for a few
+    microseconds, then parks on a semaphore that run() posts when it hands it
+    a job. Posting a semaphore takes no lock, unlike juce::WaitableEvent.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+//==============================================================================
+class ChannelWorkerPool
+{
+public:
+    /** Made by juce::SharedResourcePointer, with no workers running yet. */
+    ChannelWorkerPool()
+    {
+        for (int i = 0; i < juce::SystemStats::getNumCpus() - 1; ++i)
+            workers.push_back(std::make_unique<Worker>());
+    }
+
+    ~ChannelWorkerPool()
+    {
+        for (auto& worker : workers)
+            worker->stop();
+
+        for (auto& worker : workers)
+            worker->stopThread(1000);
+    }
+
+    //==============================================================================
+    /** Makes sure at least numWorkers are running, or one per core past the
+        first if that is fewer. From prepareToPlay. Workers are never stopped
+        before the pool goes, as other instances may be using them.
+    */
+    void reserve (int numWorkers, double sampleRate, int blockSize)
+    {
+        const juce::ScopedLock sl (startLock);
+
+        numWorkers = juce::jmin(numWorkers, (int) workers.size());
+        auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(juce::jmax(1, blockSize),
+                                                                                         juce::jmax(1.0, sampleRate));
+
+        for (auto i = numStarted.load(); i < numWorkers; ++i)
+        {
+            // without realtime rights (a sandboxed host, or no rtkit) they still run, just less reliably
+            if (! workers[(size_t) i]->startRealtimeThread(options))
+                workers[(size_t) i]->startThread(juce::Thread::Priority::highest);
+
+            numStarted.store(i + 1, std::memory_order_release);
+        }
+    }
+
+    int getNumWorkers() const noexcept      { return numStarted.load(std::memory_order_acquire); }
+
+    /** True on a worker while it runs a group, so a tool can tell work done for
+        processBlock from a worker's idle loop (see Tools/RealtimeCheck).
+    */
+    static bool isRunningGroup() noexcept   { return runningGroup; }
+
+    //==============================================================================
+    /** Calls fn (group) for every group from 0 to numGroups - 1, and returns once
+        they are all done. Group 0 runs on the calling thread, the others on any
+        idle worker or on the calling thread too. Several threads may call this
+        at once.
+    */
+    template <typename Fn>
+    void run (int numGroups, Fn& fn) noexcept
+    {
+        jassert(numGroups >= 1);
+
+        Job job;
+        job.task = [] (void* context, int group) { (*static_cast<Fn*>(context))(group); };
+        job.context = &fn;
+        job.numGroups = numGroups;
+
+        auto numStartedNow = getNumWorkers();
+
+        for (int i = 0, numPosted = 0; i < numStartedNow && numPosted < numGroups - 1; ++i)
+            if (workers[(size_t) i]->post(job))
+                ++numPosted;
+
+        fn(0);
+        job.runGroups();
+
+        // a worker that hasn't picked its job up yet isn't needed any more
+        for (int i = 0; i < numStartedNow; ++i)
+            workers[(size_t) i]->takeBack(job);
+
+        // left waiting only on groups a worker has already started
+        while (job.numAttached.load(std::memory_order_acquire) > 0)
+            pause();
+    }
+
+private:
+    //==============================================================================
+    static void pause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #else
+        std::this_thread::yield();
+       #endif
+    }
+
+    /** One call to run(), living on the caller's stack. */
+    struct Job
+    {
+        void (*task) (void*, int) = nullptr;
+        void* context = nullptr;
+        int numGroups = 0;
+
+        std::atomic<int> nextGroup { 1 };
+        std::atomic<int> numAttached { 0 };     // workers that may still touch this
+
+        void runGroups() noexcept
+        {
+            for (auto group = nextGroup.fetch_add(1); group < numGroups; group = nextGroup.fetch_add(1))
+                task(context, group);
+        }
+    };
+
+    //==============================================================================
+    /** A counting semaphore whose post() never takes a lock. */
+    class Semaphore
+    {
+    public:
+       #if JUCE_WINDOWS
+        Semaphore()             { handle = CreateSemaphore(nullptr, 0, 0x7fffffff, nullptr); }
+        ~Semaphore()            { CloseHandle(handle); }
+        void post() noexcept    { ReleaseSemaphore(handle, 1, nullptr); }
+        void wait() noexcept    { WaitForSingleObject(handle, INFINITE); }
+
+    private:
+        HANDLE handle;
+       #elif JUCE_MAC || JUCE_IOS
+        Semaphore()             { semaphore = dispatch_semaphore_create(0); }
+        ~Semaphore()            { dispatch_release(semaphore); }
+        void post() noexcept    { dispatch_semaphore_signal(semaphore); }
+        void wait() noexcept    { dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER); }
+
+    private:
+        dispatch_semaphore_t semaphore;
+       #else
+        Semaphore()             { sem_init(&semaphore, 0, 0); }
+        ~Semaphore()            { sem_destroy(&semaphore); }
+        void post() noexcept    { sem_post(&semaphore); }
+        void wait() noexcept    { while (sem_wait(&semaphore) != 0 && errno == EINTR) {} }
+
+    private:
+        sem_t semaphore;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (Semaphore)
+    };
+
+    //==============================================================================
+    // how long an idle worker spins before it parks, a few microseconds, not a whole block
+    static constexpr double spinSeconds = 10.0e-6;
+
+    class Worker  : public juce::Thread
+    {
+    public:
+        Worker() : juce::Thread ("Channel worker") {}
+
+        /** Hands an idle worker the job, false if it already has one. */
+        bool post (Job& job) noexcept
+        {
+            if (busy.load(std::memory_order_relaxed))
+                return false;
+
+            job.numAttached.fetch_add(1);
+            Job* expected = nullptr;
+
+            if (! pending.compare_exchange_strong(expected, &job))
+            {
+                job.numAttached.fetch_sub(1);
+                return false;
+            }
+
+            wake();
+            return true;
+        }
+
+        /** Takes the job back if the worker hasn't picked it up yet. */
+        void takeBack (Job& job) noexcept
+        {
+            auto* expected = &job;
+
+            if (pending.compare_exchange_strong(expected, nullptr))
+                job.numAttached.fetch_sub(1, std::memory_order_release);
+        }
+
+        void stop() noexcept
+        {
+            signalThreadShouldExit();
+            wake();
+        }
+
+        void run() override
+        {
+            juce::ScopedNoDenormals noDenormals;
+
+            while (auto* job = takeJob())
+            {
+                runningGroup = true;
+                job->runGroups();
+                runningGroup = false;
+
+                // the job may be gone as soon as this lands
+                job->numAttached.fetch_sub(1, std::memory_order_release);
+                busy.store(false, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        void wake() noexcept
+        {
+            if (parked.exchange(false))
+                semaphore.post();
+        }
+
+        /** Spins for a moment, then parks until it is handed a job. nullptr
+            once the thread should exit.
+        */
+        Job* takeJob() noexcept
+        {
+            auto spinTicks = juce::Time::secondsToHighResolutionTicks(spinSeconds);
+            auto deadline = juce::Time::getHighResolutionTicks() + spinTicks;
+
+            while (! threadShouldExit())
+            {
+                for (int spin = 0; spin < 64; ++spin)
+                {
+                    if (pending.load(std::memory_order_relaxed) != nullptr)
+                    {
+                        busy.store(true, std::memory_order_relaxed);
+
+                        if (auto* job = pending.exchange(nullptr, std::memory_order_acquire))
+                            return job;
+
+                        busy.store(false, std::memory_order_relaxed);
+                    }
+
+                    pause();
+                }
+
+                if (juce::Time::getHighResolutionTicks() >= deadline)
+                {
+                    park();
+                    deadline = juce::Time::getHighResolutionTicks() + spinTicks;
+                }
+            }
+
+            return nullptr;
+        }
+
+        void park() noexcept
+        {
+            parked.store(true);
+
+            // whoever clears parked first either skips the wait or posts for it
+            if (pending.load() != nullptr || threadShouldExit())
+                if (parked.exchange(false))
+                    return;
+
+            semaphore.wait();
+        }
+
+        std::atomic<Job*> pending { nullptr };
+        std::atomic<bool> busy { false }, parked { false };
+        Semaphore semaphore;
+    };
+
+    static inline thread_local bool runningGroup = false;
+
+    // made up front and never resized, so run() can read it while reserve() starts them
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> numStarted { 0 };
+    juce::CriticalSection startLock;
+
+    JUCE_DECLARE_NON_COPYABLE (ChannelWorkerPool)
+};
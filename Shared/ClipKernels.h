@@ -0,0 +1,375 @@
+/*
+  ==============================================================================
+
+    ClipKernels.h
+
+    The clip curves and kernels both plugins are built on, header only.
+
+    Both clippers use the same family of curves,
+
+        y = x - k * |x|^n  (sign mirrored)  for |x| <= t = n / (n - 1)
+
+    held at +-1 above t, with  k = (n - 1)^(n - 1) / n^n  so the curve
+    reaches exactly +-1 with zero slope at t. SmartClip is n = 3, which is
+    y = x - 4/27 * x^3, and 4-27 sweeps n from 1.04 to 9.04.
+
+    PowerCurve<n> is the curve for an integer n. k and t are compile time
+    constants and |x|^n is a plain chain of multiplies, so it is branch free
+    and vectorises. GenericPowerCurve is the fallback for any real n > 1,
+    using std::pow. forIntegerCurve() maps a run time exponent onto the
+    specialisations for the common exponents 2, 3, 4, 5, 6 and 8.
+
+    Every curve provides f, F1 and F2 for AntiderivativeClipper, and clip()
+    runs one over float or double samples in place, compiled for the
+    instruction set KernelDispatch picked. The cubic also has hand written
+    SSE4.2 / AVX2 / AVX-512 / NEON kernels, which clip() uses for n = 3.
+    Benchmark checks every curve against the reference formula and times
+    each one, see its "kernels" entries.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "KernelDispatch.h"
+
+namespace ClipKernels
+{
+    //==============================================================================
+    /** x^n for an integer n >= 0 known at compile time, by repeated squaring. */
+    template <int n, typename T>
+    constexpr T integerPower (T x) noexcept
+    {
+        static_assert(n >= 0, "integerPower needs a non-negative exponent");
+
+        if constexpr (n == 0)
+        {
+            return (T) 1;
+        }
+        else if constexpr (n % 2 == 0)
+        {
+            auto half = integerPower<n / 2>(x);
+            return half * half;
+        }
+        else
+        {
+            return x * integerPower<n - 1>(x);
+        }
+    }
+
+    template <typename T>
+    constexpr T magnitude (T x) noexcept        { return x < (T) 0 ? -x : x; }
+
+    //==============================================================================
+    /** The curve for an integer exponent n >= 2, with everything that depends
+        on n worked out at compile time.
+    */
+    template <int n>
+    struct PowerCurve
+    {
+        static_assert(n >= 2, "PowerCurve needs n >= 2, use GenericPowerCurve below that");
+
+        static constexpr double exponent = n;
+        static constexpr double k = integerPower<n - 1>((double) (n - 1)) / integerPower<n>((double) n);
+        static constexpr double threshold = (double) n / (double) (n - 1);
+        static constexpr double limitF1 = threshold * threshold / 2.0 - k * integerPower<n + 1>(threshold) / (n + 1);  // F1 (threshold)
+
+        /** One sample, clamped and evaluated without any branches. */
+        template <typename Sample>
+        static constexpr Sample process (Sample x) noexcept
+        {
+            constexpr auto t = (Sample) threshold;
+            auto c = x < -t ? -t : (x > t ? t : x);
+
+            // odd powers keep the sign of c, even ones get it back from c^(n - 1)
+            if constexpr (n % 2 == 1)
+                return c - (Sample) k * integerPower<n>(c);
+            else
+                return c - (Sample) k * integerPower<n - 1>(c) * magnitude(c);
+        }
+
+        double f (double x) const noexcept      { return process(x); }
+
+        // past the threshold the curve is +-1, so these carry on as its integrals
+        double F1 (double x) const noexcept
+        {
+            auto m = juce::jmin(magnitude(x), threshold);
+            return m * m / 2.0 - k * integerPower<n + 1>(m) / (n + 1) + (magnitude(x) - m);
+        }
+
+        double F2 (double x) const noexcept
+        {
+            auto m = juce::jmin(magnitude(x), threshold), d = magnitude(x) - m;
+            return std::copysign(m * m * m / 6.0 - k * integerPower<n + 2>(m) / ((n + 1) * (n + 2))
+                                   + limitF1 * d + d * d / 2.0, x);
+        }
+    };
+
+    /** The same curve for any real n > 1, evaluated with std::pow. */
+    struct GenericPowerCurve
+    {
+        GenericPowerCurve() = default;
+
+        explicit GenericPowerCurve (double n) noexcept
+            : exponent (n),
+              k (std::pow(n - 1.0, n - 1.0) / std::pow(n, n)),
+              threshold (n / (n - 1.0)),
+              limitF1 (threshold * threshold / 2.0 - k * std::pow(threshold, n + 1.0) / (n + 1.0))
+        {}
+
+        template <typename Sample>
+        Sample process (Sample x) const noexcept
+        {
+            auto t = (Sample) threshold;
+            auto c = x < -t ? -t : (x > t ? t : x);
+            return c - std::copysign((Sample) (k * std::pow((double) magnitude(c), exponent)), c);
+        }
+
+        double f (double x) const noexcept      { return process(x); }
+
+        double F1 (double x) const noexcept
+        {
+            auto m = juce::jmin(magnitude(x), threshold);
+            return m * m / 2.0 - k * std::pow(m, exponent + 1.0) / (exponent + 1.0) + (magnitude(x) - m);
+        }
+
+        double F2 (double x) const noexcept
+        {
+            auto m = juce::jmin(magnitude(x), threshold), d = magnitude(x) - m;
+            return std::copysign(m * m * m / 6.0 - k * std::pow(m, exponent + 2.0) / ((exponent + 1.0) * (exponent + 2.0))
+                                   + limitF1 * d + d * d / 2.0, x);
+        }
+
+        double exponent = 2.0, k = 0.25, threshold = 2.0;
+        double limitF1 = 4.0 / 3.0;     // F1 (threshold)
+    };
+
+    /** SmartClip's curve, y = x - 4/27 * x^3 up to 3/2. */
+    using CubicCurve = PowerCurve<3>;
+    constexpr CubicCurve cubicCurve {};
+
+    //==============================================================================
+    namespace detail
+    {
+        // each returns how far it got, the caller finishes off the rest
+       #if OMNI_KERNELS_X86
+        OMNI_KERNEL_TARGET("sse4.2") inline int cubicClipSse42 (float* data, int numSamples) noexcept
+        {
+            const auto hi = _mm_set1_ps((float) CubicCurve::threshold);
+            const auto lo = _mm_set1_ps((float) -CubicCurve::threshold);
+            const auto k = _mm_set1_ps((float) CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 4 <= numSamples; sample += 4)
+            {
+                auto x = _mm_loadu_ps(data + sample);
+                x = _mm_min_ps(_mm_max_ps(x, lo), hi);
+
+                auto x3 = _mm_mul_ps(_mm_mul_ps(x, x), x);
+                _mm_storeu_ps(data + sample, _mm_sub_ps(x, _mm_mul_ps(k, x3)));
+            }
+
+            return sample;
+        }
+
+        OMNI_KERNEL_TARGET("sse4.2") inline int cubicClipSse42 (double* data, int numSamples) noexcept
+        {
+            const auto hi = _mm_set1_pd(CubicCurve::threshold);
+            const auto lo = _mm_set1_pd(-CubicCurve::threshold);
+            const auto k = _mm_set1_pd(CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 2 <= numSamples; sample += 2)
+            {
+                auto x = _mm_loadu_pd(data + sample);
+                x = _mm_min_pd(_mm_max_pd(x, lo), hi);
+
+                auto x3 = _mm_mul_pd(_mm_mul_pd(x, x), x);
+                _mm_storeu_pd(data + sample, _mm_sub_pd(x, _mm_mul_pd(k, x3)));
+            }
+
+            return sample;
+        }
+
+        OMNI_KERNEL_TARGET("avx2,fma") inline int cubicClipAvx2 (float* data, int numSamples) noexcept
+        {
+            const auto hi = _mm256_set1_ps((float) CubicCurve::threshold);
+            const auto lo = _mm256_set1_ps((float) -CubicCurve::threshold);
+            const auto k = _mm256_set1_ps((float) CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 8 <= numSamples; sample += 8)
+            {
+                auto x = _mm256_loadu_ps(data + sample);
+                x = _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+
+                auto x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+                _mm256_storeu_ps(data + sample, _mm256_sub_ps(x, _mm256_mul_ps(k, x3)));
+            }
+
+            return sample;
+        }
+
+        OMNI_KERNEL_TARGET("avx2,fma") inline int cubicClipAvx2 (double* data, int numSamples) noexcept
+        {
+            const auto hi = _mm256_set1_pd(CubicCurve::threshold);
+            const auto lo = _mm256_set1_pd(-CubicCurve::threshold);
+            const auto k = _mm256_set1_pd(CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 4 <= numSamples; sample += 4)
+            {
+                auto x = _mm256_loadu_pd(data + sample);
+                x = _mm256_min_pd(_mm256_max_pd(x, lo), hi);
+
+                auto x3 = _mm256_mul_pd(_mm256_mul_pd(x, x), x);
+                _mm256_storeu_pd(data + sample, _mm256_sub_pd(x, _mm256_mul_pd(k, x3)));
+            }
+
+            return sample;
+        }
+
+        OMNI_KERNEL_TARGET("avx512f") inline int cubicClipAvx512 (float* data, int numSamples) noexcept
+        {
+            const auto hi = _mm512_set1_ps((float) CubicCurve::threshold);
+            const auto lo = _mm512_set1_ps((float) -CubicCurve::threshold);
+            const auto k = _mm512_set1_ps((float) CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 16 <= numSamples; sample += 16)
+            {
+                auto x = _mm512_loadu_ps(data + sample);
+                x = _mm512_min_ps(_mm512_max_ps(x, lo), hi);
+
+                auto x3 = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+                _mm512_storeu_ps(data + sample, _mm512_sub_ps(x, _mm512_mul_ps(k, x3)));
+            }
+
+            return sample;
+        }
+
+        OMNI_KERNEL_TARGET("avx512f") inline int cubicClipAvx512 (double* data, int numSamples) noexcept
+        {
+            const auto hi = _mm512_set1_pd(CubicCurve::threshold);
+            const auto lo = _mm512_set1_pd(-CubicCurve::threshold);
+            const auto k = _mm512_set1_pd(CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 8 <= numSamples; sample += 8)
+            {
+                auto x = _mm512_loadu_pd(data + sample);
+                x = _mm512_min_pd(_mm512_max_pd(x, lo), hi);
+
+                auto x3 = _mm512_mul_pd(_mm512_mul_pd(x, x), x);
+                _mm512_storeu_pd(data + sample, _mm512_sub_pd(x, _mm512_mul_pd(k, x3)));
+            }
+
+            return sample;
+        }
+       #elif OMNI_KERNELS_NEON
+        inline int cubicClipNeon (float* data, int numSamples) noexcept
+        {
+            const auto hi = vdupq_n_f32((float) CubicCurve::threshold);
+            const auto lo = vdupq_n_f32((float) -CubicCurve::threshold);
+            const auto k = vdupq_n_f32((float) CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 4 <= numSamples; sample += 4)
+            {
+                auto x = vld1q_f32(data + sample);
+                x = vminq_f32(vmaxq_f32(x, lo), hi);
+
+                auto x3 = vmulq_f32(vmulq_f32(x, x), x);
+                vst1q_f32(data + sample, vmlsq_f32(x, k, x3));
+            }
+
+            return sample;
+        }
+
+       #if defined (__aarch64__) || defined (_M_ARM64)
+        inline int cubicClipNeon (double* data, int numSamples) noexcept
+        {
+            const auto hi = vdupq_n_f64(CubicCurve::threshold);
+            const auto lo = vdupq_n_f64(-CubicCurve::threshold);
+            const auto k = vdupq_n_f64(CubicCurve::k);
+            int sample = 0;
+
+            for (; sample + 2 <= numSamples; sample += 2)
+            {
+                auto x = vld1q_f64(data + sample);
+                x = vminq_f64(vmaxq_f64(x, lo), hi);
+
+                auto x3 = vmulq_f64(vmulq_f64(x, x), x);
+                vst1q_f64(data + sample, vsubq_f64(x, vmulq_f64(k, x3)));
+            }
+
+            return sample;
+        }
+       #else
+        // 32 bit ARM NEON has no double lanes, so double runs the scalar loop there
+        inline int cubicClipNeon (double*, int) noexcept    { return 0; }
+       #endif
+       #endif
+    }
+
+    /** Applies the cubic clipper to numSamples in place, with the hand written
+        kernel for isa. The arithmetic is the same in every variant, but with
+        FMA available the compiler fuses the multiply and subtract, so AVX2 and
+        AVX-512 can differ from the others in the last bit.
+    */
+    template <typename Sample>
+    inline void cubicClip (KernelDispatch::Isa isa, Sample* data, int numSamples) noexcept
+    {
+        int sample = 0;
+
+        switch (isa)
+        {
+           #if OMNI_KERNELS_X86
+            case KernelDispatch::Isa::sse42:    sample = detail::cubicClipSse42(data, numSamples); break;
+            case KernelDispatch::Isa::avx2:     sample = detail::cubicClipAvx2(data, numSamples); break;
+            case KernelDispatch::Isa::avx512:   sample = detail::cubicClipAvx512(data, numSamples); break;
+           #elif OMNI_KERNELS_NEON
+            case KernelDispatch::Isa::neon:     sample = detail::cubicClipNeon(data, numSamples); break;
+           #endif
+            default:                            break;
+        }
+
+        // the generic variant and the leftover samples
+        for (; sample < numSamples; ++sample)
+            data[sample] = CubicCurve::process(data[sample]);
+    }
+
+    //==============================================================================
+    /** Runs a curve over numSamples in place, in a loop compiled for isa. */
+    template <typename Curve, typename Sample>
+    inline void clip (KernelDispatch::Isa isa, const Curve& curve, Sample* data, int numSamples) noexcept
+    {
+        KernelDispatch::forEachSample(isa, numSamples, [&curve, data] (int i) { data[i] = curve.process(data[i]); });
+    }
+
+    inline void clip (KernelDispatch::Isa isa, const CubicCurve&, float* data, int numSamples) noexcept     { cubicClip(isa, data, numSamples); }
+    inline void clip (KernelDispatch::Isa isa, const CubicCurve&, double* data, int numSamples) noexcept    { cubicClip(isa, data, numSamples); }
+
+    /** If n is one of the specialised exponents, calls fn with its PowerCurve and
+        returns true. Otherwise returns false and the caller falls back to a
+        GenericPowerCurve.
+    */
+    template <typename Fn>
+    inline bool forIntegerCurve (double n, Fn&& fn)
+    {
+        if (n != std::floor(n) || n < 2.0 || n > 8.0)
+            return false;
+
+        switch ((int) n)
+        {
+            case 2:     fn(PowerCurve<2> {}); return true;
+            case 3:     fn(PowerCurve<3> {}); return true;
+            case 4:     fn(PowerCurve<4> {}); return true;
+            case 5:     fn(PowerCurve<5> {}); return true;
+            case 6:     fn(PowerCurve<6> {}); return true;
+            case 8:     fn(PowerCurve<8> {}); return true;
+            default:    return false;
+        }
+    }
+}
@@ -0,0 +1,453 @@
+/*
+  ==============================================================================
+
+    ClipOversampler.h
+
+    Runs just the nonlinear part of a plugin (its clipper) at 2x, 4x, 8x or
+    16x the sample rate, so the harmonics it makes above nyquist are filtered
+    out instead of aliasing back down. Everything else stays at 1x.
+
+    The same cascade of polyphase half-band filters as juce::dsp::Oversampling
+    at maximum quality with integer latency, one 2x stage per doubling:
+
+        minimum phase   polyphase IIR half-bands, a few samples of latency
+        linear phase    equiripple FIR half-bands, no phase distortion but
+                        much more latency
+
+    juce::dsp::Oversampling designs its filters inside every object it
+    builds, and every tier of every instance built its own, 4 tiers and 2
+    phases for each precision. Here the filters of each stage are designed
+    once for the whole process and shared through SharedTableStore, see
+    StageFilters. The designs are normalised to the rate they run at, so
+    the sample rate doesn't enter the key. Stage n is the same filter in
+    every tier that has it, so the tiers also share one chain of stages per
+    phase, and an instance only holds the filter state and buffers of those.
+
+    Every stage is built in prepare(), so switching tiers on the audio thread
+    never allocates. The fractional part of the latency is made up with a
+    Thiran allpass delay, as juce::dsp::Oversampling does, so it can be
+    reported to the host in whole samples.
+
+    CPU cost, on top of the clipper itself running factor times as often:
+    every stage runs at twice the rate of the one before it, but the later
+    stages have wider transition bands and so shorter filters, which keeps
+    each extra tier at roughly twice the cost of the previous one. The FIR
+    filters cost a few times more than the IIR ones at the same factor.
+    Benchmark times every tier, see its "os" entries.
+
+    Sample is the host's precision, float or double, so the up and down
+    sampling filters run in the same precision as the rest of the chain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedTableStore.h"
+
+//==============================================================================
+template <typename Sample>
+class ClipOversampler
+{
+public:
+    ClipOversampler() = default;
+
+    // Off, 2x, 4x, 8x, 16x
+    static constexpr int numTiers = 5;
+    static constexpr int maxFactor = 1 << (numTiers - 1);
+
+    static juce::StringArray getTierNames()     { return { "Off", "2x", "4x", "8x", "16x" }; }
+
+    //==============================================================================
+    /** The up and down filters of one 2x stage, in one phase. Immutable once
+        built, and shared by every instance in the process.
+    */
+    struct StageFilters
+    {
+        bool linearPhase = false;
+
+        // FIR: the half-band kernels. IIR: the allpass coefficients of the
+        // direct and delayed paths, the delayed path's leading unit delay left out
+        std::vector<Sample> up, down;
+        int numDirectUp = 0, numDirectDown = 0;
+
+        // up and down together, in samples at the stage's higher rate
+        double latency = 0.0;
+
+        size_t getMemoryUsage() const noexcept   { return sizeof (*this) + (up.capacity() + down.capacity()) * sizeof (Sample); }
+    };
+
+    /** The filters for stage (0 for the first doubling) from the store,
+        designed if no instance holds them. Allocates, so call it from prepare.
+    */
+    static std::shared_ptr<const StageFilters> getStageFilters (SharedTableStore& store, int stage, bool linearPhase)
+    {
+        juce::String id ("oversampling ");
+        id << (linearPhase ? "fir " : "iir ") << (sizeof (Sample) == sizeof (float) ? "float" : "double");
+
+        return store.get<StageFilters>({ id, 0.0, 0.0, stage }, [=] { return designStage(stage, linearPhase); });
+    }
+
+    //==============================================================================
+    /** Builds every stage, from prepareToPlay. */
+    void prepare (int numChannels, int maximumBlockSize, SharedTableStore& store)
+    {
+        maxBlockSize = juce::jmax(1, maximumBlockSize);
+
+        for (int linearPhase = 0; linearPhase < 2; ++linearPhase)
+        {
+            auto stageBlockSize = maxBlockSize;
+
+            for (int stage = 0; stage < numTiers - 1; ++stage)
+            {
+                chains[(size_t) linearPhase][(size_t) stage].prepare(getStageFilters(store, stage, linearPhase != 0),
+                                                                     numChannels, stageBlockSize);
+                stageBlockSize *= 2;
+            }
+        }
+
+        delay.prepare({ 0.0, (juce::uint32) maxBlockSize, (juce::uint32) juce::jmax(1, numChannels) });
+
+        currentTier = 0;
+        currentLinearPhase = false;
+        fractionalDelay = 0;
+        latency = 0;
+    }
+
+    /** Picks the tier to run from now on, the processor then reports
+        getLatencyInSamples() to the host.
+    */
+    void select (int tier, bool linearPhase) noexcept
+    {
+        tier = juce::jlimit(0, numTiers - 1, tier);
+
+        if (tier == currentTier && (linearPhase == currentLinearPhase || tier == 0))
+            return;
+
+        currentTier = tier;
+        currentLinearPhase = linearPhase;
+
+        // the latency in base rate samples, each stage's divided by the rate it runs at
+        double uncompensated = 0.0;
+
+        for (int stage = 0; stage < tier; ++stage)
+            uncompensated += getChain()[(size_t) stage].filters->latency / (double) (2 << stage);
+
+        // made up to a whole number of samples, never with less than 0.618 of
+        // Thiran delay as shorter ones ring, as juce::dsp::Oversampling does
+        fractionalDelay = 1.0 - (uncompensated - std::floor(uncompensated));
+
+        if (juce::approximatelyEqual(fractionalDelay, 1.0))
+            fractionalDelay = 0.0;
+        else if (fractionalDelay < 0.618)
+            fractionalDelay += 1.0;
+
+        latency = tier > 0 ? juce::roundToInt(uncompensated + fractionalDelay) : 0;
+        delay.setDelay((Sample) fractionalDelay);
+
+        // it last ran some time ago, if ever, so its filters hold stale state
+        reset();
+    }
+
+    /** Clears the current tier's filters. */
+    void reset() noexcept
+    {
+        for (int stage = 0; stage < currentTier; ++stage)
+            getChain()[(size_t) stage].reset();
+
+        delay.reset();
+    }
+
+    int getFactor() const noexcept              { return 1 << currentTier; }
+
+    int getLatencyInSamples() const noexcept    { return latency; }
+
+    //==============================================================================
+    /** Runs nonlinearity (int channel, Sample* samples, int numSamples) over
+        every channel of the block, upsampled by the current factor. Blocks larger than the
+        prepared size are worked through in pieces.
+    */
+    template <typename Fn>
+    void process (juce::dsp::AudioBlock<Sample> block, Fn&& nonlinearity) noexcept
+    {
+        auto numChannels = block.getNumChannels();
+        auto numSamples = block.getNumSamples();
+
+        if (currentTier == 0)
+        {
+            for (size_t channel = 0; channel < numChannels; ++channel)
+                nonlinearity((int) channel, block.getChannelPointer(channel), (int) numSamples);
+
+            return;
+        }
+
+        auto& chain = getChain();
+        auto lastStage = (size_t) currentTier - 1;
+
+        for (size_t start = 0; start < numSamples; start += (size_t) maxBlockSize)
+        {
+            auto piece = block.getSubBlock(start, juce::jmin((size_t) maxBlockSize, numSamples - start));
+            auto upsampled = piece;
+
+            for (size_t stage = 0; stage <= lastStage; ++stage)
+                upsampled = chain[stage].processUp(upsampled);
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+                nonlinearity((int) channel, upsampled.getChannelPointer(channel), (int) upsampled.getNumSamples());
+
+            // each stage writes its output down into the buffer of the stage before it
+            for (auto stage = lastStage; stage > 0; --stage)
+                chain[stage].processDown(chain[stage - 1].getOutput(piece.getNumSamples() << stage));
+
+            chain[0].processDown(piece);
+
+            if (fractionalDelay > 0.0)
+            {
+                for (size_t channel = 0; channel < numChannels; ++channel)
+                {
+                    auto* samples = piece.getChannelPointer(channel);
+
+                    for (size_t i = 0; i < piece.getNumSamples(); ++i)
+                    {
+                        delay.pushSample((int) channel, samples[i]);
+                        samples[i] = delay.popSample((int) channel);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    // one instance's state for one 2x stage, running the shared filters
+    struct Stage
+    {
+        std::shared_ptr<const StageFilters> filters;
+        juce::AudioBuffer<Sample> buffer;               // the upsampled signal
+        juce::AudioBuffer<Sample> stateUp, stateDown, stateDown2;
+        std::vector<size_t> position;                   // FIR decimator's circular buffer
+        std::vector<Sample> delayDown;                  // IIR decimator's delayed path
+
+        void prepare (std::shared_ptr<const StageFilters> stageFilters, int numChannels, int maxInputSamples)
+        {
+            filters = std::move(stageFilters);
+            numChannels = juce::jmax(1, numChannels);
+
+            auto numUp = (int) filters->up.size(), numDown = (int) filters->down.size();
+
+            buffer.setSize(numChannels, maxInputSamples * 2, false, false, true);
+            stateUp.setSize(numChannels, numUp);
+            stateDown.setSize(numChannels, numDown);
+            stateDown2.setSize(numChannels, filters->linearPhase ? numDown / 4 + 1 : 1);
+            position.resize((size_t) numChannels);
+            delayDown.resize((size_t) numChannels);
+            reset();
+        }
+
+        void reset() noexcept
+        {
+            stateUp.clear();
+            stateDown.clear();
+            stateDown2.clear();
+            std::fill(position.begin(), position.end(), (size_t) 0);
+            std::fill(delayDown.begin(), delayDown.end(), (Sample) 0);
+        }
+
+        juce::dsp::AudioBlock<Sample> getOutput (size_t numSamples) noexcept
+        {
+            return juce::dsp::AudioBlock<Sample>(buffer).getSubBlock(0, numSamples);
+        }
+
+        /** Upsamples input into buffer and returns the upsampled block. */
+        juce::dsp::AudioBlock<Sample> processUp (const juce::dsp::AudioBlock<Sample>& input) noexcept
+        {
+            auto numSamples = input.getNumSamples();
+            const auto& fir = filters->up;
+
+            for (size_t channel = 0; channel < input.getNumChannels(); ++channel)
+            {
+                auto* samples = input.getChannelPointer(channel);
+                auto* output = buffer.getWritePointer((int) channel);
+                auto* state = stateUp.getWritePointer((int) channel);
+
+                if (filters->linearPhase)
+                {
+                    auto n = fir.size(), half = n / 2;
+
+                    for (size_t i = 0; i < numSamples; ++i)
+                    {
+                        state[n - 1] = 2 * samples[i];
+
+                        // the half-band kernel is symmetric and every other tap is zero
+                        Sample out = 0;
+
+                        for (size_t k = 0; k < half; k += 2)
+                            out += (state[k] + state[n - k - 1]) * fir[k];
+
+                        output[i << 1] = out;
+                        output[(i << 1) + 1] = state[half + 1] * fir[half];
+
+                        for (size_t k = 0; k < n - 2; k += 2)
+                            state[k] = state[k + 2];
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < numSamples; ++i)
+                    {
+                        output[i << 1] = allpasses(state, fir.data(), 0, filters->numDirectUp, samples[i]);
+                        output[(i << 1) + 1] = allpasses(state, fir.data(), filters->numDirectUp, (int) fir.size(), samples[i]);
+                    }
+
+                    snapToZero(state, (int) fir.size());
+                }
+            }
+
+            return getOutput(numSamples * 2);
+        }
+
+        /** Downsamples buffer into output, which has half as many samples. */
+        void processDown (const juce::dsp::AudioBlock<Sample>& output) noexcept
+        {
+            auto numSamples = output.getNumSamples();
+            const auto& fir = filters->down;
+
+            for (size_t channel = 0; channel < output.getNumChannels(); ++channel)
+            {
+                auto* samples = output.getChannelPointer(channel);
+                auto* input = buffer.getReadPointer((int) channel);
+                auto* state = stateDown.getWritePointer((int) channel);
+
+                if (filters->linearPhase)
+                {
+                    auto n = fir.size(), half = n / 2, quarter = half / 2;
+                    auto* centre = stateDown2.getWritePointer((int) channel);
+                    auto pos = position[channel];
+
+                    for (size_t i = 0; i < numSamples; ++i)
+                    {
+                        state[n - 1] = input[i << 1];
+
+                        Sample out = 0;
+
+                        for (size_t k = 0; k < half; k += 2)
+                            out += (state[k] + state[n - k - 1]) * fir[k];
+
+                        // the odd samples only ever meet the centre tap, through a delay line
+                        out += centre[pos] * fir[half];
+                        centre[pos] = input[(i << 1) + 1];
+                        samples[i] = out;
+
+                        for (size_t k = 0; k < n - 2; ++k)
+                            state[k] = state[k + 2];
+
+                        pos = pos == 0 ? quarter : pos - 1;
+                    }
+
+                    position[channel] = pos;
+                }
+                else
+                {
+                    auto delayed = delayDown[channel];
+
+                    for (size_t i = 0; i < numSamples; ++i)
+                    {
+                        auto direct = allpasses(state, fir.data(), 0, filters->numDirectDown, input[i << 1]);
+                        samples[i] = (delayed + direct) * (Sample) 0.5;
+                        delayed = allpasses(state, fir.data(), filters->numDirectDown, (int) fir.size(), input[(i << 1) + 1]);
+                    }
+
+                    delayDown[channel] = delayed;
+                    snapToZero(state, (int) fir.size());
+                }
+            }
+        }
+
+        // a cascade of first order allpasses, one per rate of the polyphase branch
+        static Sample allpasses (Sample* state, const Sample* alphas, int first, int last, Sample input) noexcept
+        {
+            for (int n = first; n < last; ++n)
+            {
+                auto output = alphas[n] * input + state[n];
+                state[n] = input - alphas[n] * output;
+                input = output;
+            }
+
+            return input;
+        }
+
+        static void snapToZero (Sample* state, int numStates) noexcept
+        {
+            for (int n = 0; n < numStates; ++n)
+                juce::dsp::util::snapToZero(state[n]);
+        }
+    };
+
+    using Chain = std::array<Stage, numTiers - 1>;
+
+    // the same transition widths and stopbands as juce::dsp::Oversampling at
+    // maximum quality, the first stage sharpest as it guards the audio band
+    static std::shared_ptr<StageFilters> designStage (int stage, bool linearPhase)
+    {
+        using Design = juce::dsp::FilterDesign<Sample>;
+
+        auto widthUp = (Sample) (0.10 * (stage == 0 ? 0.5 : 1.0));
+        auto widthDown = (Sample) (0.12 * (stage == 0 ? 0.5 : 1.0));
+        auto stopbandUp = (Sample) (-90.0 + 10.0 * stage);
+        auto stopbandDown = (Sample) (-75.0 + 10.0 * stage);
+
+        auto filters = std::make_shared<StageFilters>();
+        filters->linearPhase = linearPhase;
+
+        if (linearPhase)
+        {
+            auto up = Design::designFIRLowpassHalfBandEquirippleMethod(widthUp, stopbandUp);
+            auto down = Design::designFIRLowpassHalfBandEquirippleMethod(widthDown, stopbandDown);
+
+            filters->up.assign(up->coefficients.begin(), up->coefficients.end());
+            filters->down.assign(down->coefficients.begin(), down->coefficients.end());
+            filters->latency = 0.5 * (up->getFilterOrder() + down->getFilterOrder());
+            return filters;
+        }
+
+        // the group delay at DC of one polyphase half-band: half the delayed
+        // path's unit delay, plus half of what each allpass in z^-2 adds
+        auto flatten = [] (const auto& structure, std::vector<Sample>& alphas, int& numDirect)
+        {
+            double delay = 1.0;
+
+            for (auto* section : structure.directPath)
+                alphas.push_back(section->coefficients[0]);
+
+            numDirect = (int) alphas.size();
+
+            for (int i = 1; i < structure.delayedPath.size(); ++i)
+                alphas.push_back(structure.delayedPath.getObjectPointer(i)->coefficients[0]);
+
+            for (auto alpha : alphas)
+                delay += 2.0 * (1.0 - alpha) / (1.0 + alpha);
+
+            return 0.5 * delay;
+        };
+
+        filters->latency = flatten(Design::designIIRLowpassHalfBandPolyphaseAllpassMethod(widthUp, stopbandUp),
+                                   filters->up, filters->numDirectUp)
+                         + flatten(Design::designIIRLowpassHalfBandPolyphaseAllpassMethod(widthDown, stopbandDown),
+                                   filters->down, filters->numDirectDown);
+        return filters;
+    }
+
+    Chain& getChain() noexcept      { return chains[currentLinearPhase ? 1 : 0]; }
+
+    std::array<Chain, 2> chains;    // [linear phase]
+    juce::dsp::DelayLine<Sample, juce::dsp::DelayLineInterpolationTypes::Thiran> delay { 8 };
+
+    int currentTier = 0;
+    bool currentLinearPhase = false;
+    double fractionalDelay = 0.0;
+    int latency = 0;
+    int maxBlockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ClipOversampler)
+};
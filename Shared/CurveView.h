@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    CurveView.h
+
+    Draws a static transfer curve, input level across, output level up, both
+    from -1 to +1, with a grid and optional threshold markers.
+
+    The curve is rendered into an Image when setCurve() is called or the
+    component is resized, and paint() only blits that image. The editor calls
+    setCurve() when a parameter the curve depends on has changed, not every
+    frame, so the curve costs nothing while it stands still.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class CurveView : public juce::Component
+{
+public:
+    /** One line of the graph, y = function (x) for x in -1 to 1. */
+    struct Trace
+    {
+        std::function<float (float)> function;
+        juce::Colour colour;
+        juce::String name;
+    };
+
+    CurveView() = default;
+
+    /** Replaces the traces and markers, and renders them. thresholds are linear
+        levels drawn as dashed lines on both axes.
+    */
+    void setCurve (std::vector<Trace> newTraces, std::vector<float> newThresholds = {})
+    {
+        traces = std::move(newTraces);
+        thresholds = std::move(newThresholds);
+        render();
+    }
+
+    //==============================================================================
+    void paint (juce::Graphics& g) override
+    {
+        g.drawImageAt(image, 0, 0);
+    }
+
+    void resized() override
+    {
+        render();
+    }
+
+private:
+    //==============================================================================
+    void render()
+    {
+        if (getWidth() <= 0 || getHeight() <= 0)
+            return;
+
+        auto scale = juce::Component::getApproximateScaleFactorForComponent(this);
+        image = juce::Image(juce::Image::ARGB, getWidth(), getHeight(), true);
+
+        juce::Graphics g(image);
+        auto area = getLocalBounds().toFloat().reduced(4.0f);
+        auto legend = area.removeFromBottom(16.0f);
+
+        auto toX = [area] (float x) { return area.getX() + area.getWidth() * (x + 1.0f) * 0.5f; };
+        auto toY = [area] (float y) { return area.getBottom() - area.getHeight() * (juce::jlimit(-1.0f, 1.0f, y) + 1.0f) * 0.5f; };
+
+        g.setColour(juce::Colours::black.withAlpha(0.4f));
+        g.fillRect(area);
+
+        g.setColour(juce::Colours::white.withAlpha(0.1f));
+
+        for (auto grid : { -0.5f, 0.0f, 0.5f })
+        {
+            g.drawVerticalLine(juce::roundToInt(toX(grid)), area.getY(), area.getBottom());
+            g.drawHorizontalLine(juce::roundToInt(toY(grid)), area.getX(), area.getRight());
+        }
+
+        g.drawLine(toX(-1.0f), toY(-1.0f), toX(1.0f), toY(1.0f));
+
+        const float dashes[] = { 3.0f, 3.0f };
+        g.setColour(juce::Colours::orange.withAlpha(0.5f));
+
+        for (auto threshold : thresholds)
+        {
+            if (threshold <= 0.0f || threshold >= 1.0f)
+                continue;
+
+            for (auto level : { -threshold, threshold })
+            {
+                g.drawDashedLine({ toX(level), area.getY(), toX(level), area.getBottom() }, dashes, 2);
+                g.drawDashedLine({ area.getX(), toY(level), area.getRight(), toY(level) }, dashes, 2);
+            }
+        }
+
+        // one point per physical pixel is plenty, the curves are smooth
+        auto numPoints = juce::jmax(2, juce::roundToInt(area.getWidth() * scale));
+        auto legendX = legend.getX();
+
+        for (auto& trace : traces)
+        {
+            juce::Path path;
+
+            for (int i = 0; i < numPoints; ++i)
+            {
+                auto x = -1.0f + 2.0f * (float) i / (float) (numPoints - 1);
+                auto point = juce::Point<float>(toX(x), toY(trace.function(x)));
+
+                if (i == 0)
+                    path.startNewSubPath(point);
+                else
+                    path.lineTo(point);
+            }
+
+            g.setColour(trace.colour);
+            g.strokePath(path, juce::PathStrokeType(1.5f));
+
+            g.setFont(11.0f);
+            auto width = (float) g.getCurrentFont().getStringWidth(trace.name) + 12.0f;
+            g.drawText(trace.name, juce::Rectangle<float>(legendX, legend.getY(), width, legend.getHeight()),
+                       juce::Justification::centredLeft);
+            legendX += width;
+        }
+
+        repaint();
+    }
+
+    std::vector<Trace> traces;
+    std::vector<float> thresholds;
+    juce::Image image;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CurveView)
+};
@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    KernelDispatch.h
+
+    Picks the instruction set the hot loops run with, at run time.
+
+    One binary has to run on anything from an SSE4.2 only Xeon to an AVX-512
+    workstation, and on ARM64. So the kernels that matter (the clippers, the
+    4-27 curve tiers, the gain and sum stages) are compiled once per
+    instruction set, and select() picks the best one the CPU has from CPUID
+    (or the hwcaps on ARM) through juce::SystemStats.
+
+        generic     the plain C++, as the compiler builds it for the target
+        sse4.2      x86, 128 bit
+        avx2        x86, 256 bit with FMA
+        avx512      x86, 512 bit (AVX-512F)
+        neon        ARM, 128 bit
+
+    Setting OMNI_KERNELS to one of those names overrides the choice, for
+    testing. A variant the CPU doesn't have is ignored and the best one is
+    used instead.
+
+    The processors call select() in prepareToPlay and hand the result to
+    every kernel, so nothing is detected on the audio thread. Plain loops go
+    through forEachSample(), which is built once per instruction set with
+    the GCC / Clang target attribute and flattened, so the loop body is
+    inlined and vectorised for that instruction set. MSVC has no per
+    function targets, so there only the hand written intrinsics (see
+    ClipKernels::cubicClip) differ between the variants.
+
+    The variants agree to within a rounding, not to the bit, as the AVX2 and
+    AVX-512 ones may fuse multiplies and adds.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define OMNI_KERNEL_TARGET(isa) __attribute__ ((target (isa), flatten))
+#else
+ #define OMNI_KERNEL_TARGET(isa)
+#endif
+
+#if JUCE_INTEL
+ #define OMNI_KERNELS_X86 1
+ #include <immintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+ #define OMNI_KERNELS_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace KernelDispatch
+{
+    //==============================================================================
+    enum class Isa
+    {
+        generic,
+        sse42,
+        avx2,
+        avx512,
+        neon
+    };
+
+    /** Every variant, slowest first. */
+    constexpr Isa allIsas[] = { Isa::generic, Isa::sse42, Isa::avx2, Isa::avx512, Isa::neon };
+
+    inline const char* getName (Isa isa) noexcept
+    {
+        switch (isa)
+        {
+            case Isa::sse42:    return "sse4.2";
+            case Isa::avx2:     return "avx2";
+            case Isa::avx512:   return "avx512";
+            case Isa::neon:     return "neon";
+            case Isa::generic:
+            default:            return "generic";
+        }
+    }
+
+    /** True if this build has the variant and this CPU can run it. */
+    inline bool isSupported (Isa isa) noexcept
+    {
+        switch (isa)
+        {
+            case Isa::generic:  return true;
+           #if OMNI_KERNELS_X86
+            case Isa::sse42:    return juce::SystemStats::hasSSE42();
+            case Isa::avx2:     return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+            case Isa::avx512:   return juce::SystemStats::hasAVX512F();
+           #elif OMNI_KERNELS_NEON
+            case Isa::neon:     return juce::SystemStats::hasNeon();
+           #endif
+            default:            return false;
+        }
+    }
+
+    /** What OMNI_KERNELS is set to, empty if it isn't. */
+    inline juce::String getOverride()
+    {
+        return juce::SystemStats::getEnvironmentVariable("OMNI_KERNELS", {}).trim();
+    }
+
+    /** The best supported variant, or OMNI_KERNELS if it names a supported one.
+        Allocates, so call it from prepareToPlay.
+    */
+    inline Isa select()
+    {
+        auto best = Isa::generic;
+
+        for (auto isa : allIsas)
+            if (isSupported(isa))
+                best = isa;
+
+        auto requested = getOverride();
+
+        if (requested.isEmpty())
+            return best;
+
+        for (auto isa : allIsas)
+            if (requested.equalsIgnoreCase(getName(isa)) && isSupported(isa))
+                return isa;
+
+        // an override the CPU can't run is ignored, the tools report it, see getOverride()
+        return best;
+    }
+
+    //==============================================================================
+    namespace detail
+    {
+        template <typename Fn>
+        void loopGeneric (int numSamples, Fn& fn) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                fn(i);
+        }
+
+       #if OMNI_KERNELS_X86
+        template <typename Fn>
+        OMNI_KERNEL_TARGET("sse4.2") void loopSse42 (int numSamples, Fn& fn) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                fn(i);
+        }
+
+        template <typename Fn>
+        OMNI_KERNEL_TARGET("avx2,fma") void loopAvx2 (int numSamples, Fn& fn) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                fn(i);
+        }
+
+        template <typename Fn>
+        OMNI_KERNEL_TARGET("avx512f") void loopAvx512 (int numSamples, Fn& fn) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                fn(i);
+        }
+       #endif
+    }
+
+    /** Calls fn(i) for i = 0 to numSamples - 1, in a loop compiled for isa.
+        fn should be a small lambda with no calls the compiler can't inline,
+        or the loop won't vectorise.
+    */
+    template <typename Fn>
+    inline void forEachSample (Isa isa, int numSamples, Fn&& fn) noexcept
+    {
+        switch (isa)
+        {
+           #if OMNI_KERNELS_X86
+            case Isa::sse42:    detail::loopSse42(numSamples, fn); break;
+            case Isa::avx2:     detail::loopAvx2(numSamples, fn); break;
+            case Isa::avx512:   detail::loopAvx512(numSamples, fn); break;
+           #endif
+            case Isa::generic:
+            case Isa::neon:     // NEON is the baseline wherever it is built
+            default:            detail::loopGeneric(numSamples, fn); break;
+        }
+    }
+
+    //==============================================================================
+    /** dest[i] *= gains[i], for gain ramps. */
+    template <typename Sample>
+    inline void multiply (Isa isa, Sample* dest, const float* gains, int numSamples) noexcept
+    {
+        forEachSample(isa, numSamples, [=] (int i) { dest[i] *= (Sample) gains[i]; });
+    }
+
+    /** dest[i] += source[i], for summing bands. */
+    template <typename Sample>
+    inline void add (Isa isa, Sample* dest, const Sample* source, int numSamples) noexcept
+    {
+        forEachSample(isa, numSamples, [=] (int i) { dest[i] += source[i]; });
+    }
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    LatencyReporter.h
+
+    Tells the host about a latency that changed on the audio thread, from
+    the message thread.
+
+    The oversampling tier and the lookahead are switched on the audio thread
+    as their parameters move, but setLatencySamples() calls back into the
+    host wrapper (ioChanged, restartComponent, updateHostDisplay), which
+    locks and allocates and expects the message thread. So the audio thread
+    only stores the new latency in an atomic here, and a timer on the
+    message thread passes it on. An AsyncUpdater would be quicker, but
+    triggering one posts a message, which takes the message queue's lock.
+
+        reporter.reportNow (samples);   // prepareToPlay, straight to the host
+        reporter.report (samples);      // audio thread, passed on later
+        reporter.get();                 // the latency the chain runs at now
+
+    get() is what the chain itself should use (tails, the silence gate), as
+    getLatencySamples() lags until the timer has caught up.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class LatencyReporter  : private juce::Timer
+{
+public:
+    explicit LatencyReporter (juce::AudioProcessor& processorToReportFor)
+        : processor(processorToReportFor)
+    {
+        startTimer(pollIntervalMs);
+    }
+
+    ~LatencyReporter() override
+    {
+        stopTimer();
+    }
+
+    /** Not on the audio thread. Reports a latency to the host straight away. */
+    void reportNow (int numSamples)
+    {
+        latency.store(numSamples, std::memory_order_relaxed);
+        processor.setLatencySamples(numSamples);
+    }
+
+    /** Audio thread. Only stores the latency, the timer reports it. */
+    void report (int numSamples) noexcept   { latency.store(numSamples, std::memory_order_relaxed); }
+
+    /** The latency last reported, whether or not the host has heard yet. Any thread. */
+    int get() const noexcept                { return latency.load(std::memory_order_relaxed); }
+
+private:
+    //==============================================================================
+    // often enough that a host recompensates within a few blocks of the change
+    static constexpr int pollIntervalMs = 50;
+
+    void timerCallback() override
+    {
+        // only tells the host when it actually changes
+        processor.setLatencySamples(get());
+    }
+
+    juce::AudioProcessor& processor;
+    std::atomic<int> latency { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (LatencyReporter)
+};
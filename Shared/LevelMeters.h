@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    LevelMeters.h
+
+    The input / output peak and RMS and the gain reduction of a processor,
+    handed from the audio thread to its editor without locks.
+
+    The audio thread measures each block and pushes one Frame into an
+    SpscRing, the editor pops them on its timer. Nothing is measured unless
+    an editor has called setActive (true), so a closed plugin window costs
+    the audio thread one relaxed atomic load per block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpscRing.h"
+
+//==============================================================================
+class LevelMeters
+{
+public:
+    static constexpr int maxGainReductions = 8;
+
+    /** One block. Levels are linear gains, gain reduction is in dB as positive numbers. */
+    struct Frame
+    {
+        float inputPeak = 0.0f, inputRms = 0.0f;
+        float outputPeak = 0.0f, outputRms = 0.0f;
+        int numGainReductions = 0;
+        std::array<float, maxGainReductions> gainReduction {};
+    };
+
+    LevelMeters() = default;
+
+    //==============================================================================
+    /** Audio thread. Read it once per block and skip the rest when it is false. */
+    bool isActive() const noexcept      { return active.load(std::memory_order_relaxed); }
+
+    template <typename Sample>
+    void measureInput (const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+    {
+        measure(buffer, numChannels, pending.inputPeak, pending.inputRms);
+    }
+
+    template <typename Sample>
+    void measureOutput (const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+    {
+        measure(buffer, numChannels, pending.outputPeak, pending.outputRms);
+    }
+
+    void setGainReduction (int index, float decibels) noexcept
+    {
+        if (index < maxGainReductions)
+        {
+            pending.gainReduction[(size_t) index] = decibels;
+            pending.numGainReductions = juce::jmax(pending.numGainReductions, index + 1);
+        }
+    }
+
+    /** Audio thread, at the end of the block. Dropped if the editor is behind. */
+    void publish() noexcept
+    {
+        frames.push(pending);
+        pending = {};
+    }
+
+    //==============================================================================
+    /** Editor side. Starts or stops the measuring, and throws away anything stale. */
+    void setActive (bool shouldBeActive) noexcept
+    {
+        frames.clear();
+        active.store(shouldBeActive, std::memory_order_relaxed);
+    }
+
+    /** Editor side. Returns false when there is nothing new. */
+    bool pop (Frame& frame) noexcept    { return frames.pop(frame); }
+
+private:
+    //==============================================================================
+    template <typename Sample>
+    static void measure (const juce::AudioBuffer<Sample>& buffer, int numChannels, float& peak, float& rms) noexcept
+    {
+        auto numSamples = buffer.getNumSamples();
+        double sumOfSquares = 0.0;
+        peak = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            peak = juce::jmax(peak, (float) buffer.getMagnitude(channel, 0, numSamples));
+
+            auto channelRms = (double) buffer.getRMSLevel(channel, 0, numSamples);
+            sumOfSquares += channelRms * channelRms;
+        }
+
+        rms = numChannels > 0 ? (float) std::sqrt(sumOfSquares / numChannels) : 0.0f;
+    }
+
+    Frame pending;
+    std::atomic<bool> active { false };
+    SpscRing<Frame, 128> frames;
+
+    JUCE_DECLARE_NON_COPYABLE (LevelMeters)
+};
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    MeterView.h
+
+    Draws a processor's LevelMeters: input and output as peak and RMS bars,
+    then one bar per limiter hanging down from the top for gain reduction.
+
+    update() drains the frames and applies the ballistics, and only asks for
+    a repaint when a bar has moved by a visible amount, so an idle meter
+    costs next to nothing. The editor calls it from a timer, which sets the
+    frame rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LevelMeters.h"
+
+//==============================================================================
+class MeterView : public juce::Component
+{
+public:
+    MeterView() = default;
+
+    /** Names the gain reduction bars, in the order the processor reports them. */
+    void setGainReductionNames (const juce::StringArray& names)
+    {
+        gainReductionNames = names;
+        repaint();
+    }
+
+    /** Reads every frame waiting and moves the bars on by elapsedSeconds. */
+    void update (LevelMeters& meters, double elapsedSeconds)
+    {
+        // peaks fall at 20 dB / s, RMS follows a 300 ms one pole
+        auto fall = juce::Decibels::decibelsToGain((float) (-20.0 * elapsedSeconds));
+        auto rmsCoefficient = (float) std::exp(-elapsedSeconds / 0.3);
+
+        Levels next = levels;
+        next.inputPeak *= fall;
+        next.outputPeak *= fall;
+
+        for (auto& gr : next.gainReduction)
+            gr = juce::jmax(0.0f, gr - (float) (20.0 * elapsedSeconds));
+
+        float inputRms = 0.0f, outputRms = 0.0f;
+
+        for (LevelMeters::Frame frame; meters.pop(frame);)
+        {
+            next.inputPeak = juce::jmax(next.inputPeak, frame.inputPeak);
+            next.outputPeak = juce::jmax(next.outputPeak, frame.outputPeak);
+            inputRms = juce::jmax(inputRms, frame.inputRms);
+            outputRms = juce::jmax(outputRms, frame.outputRms);
+            next.numGainReductions = frame.numGainReductions;
+
+            for (int index = 0; index < frame.numGainReductions; ++index)
+                next.gainReduction[(size_t) index] = juce::jmax(next.gainReduction[(size_t) index],
+                                                                frame.gainReduction[(size_t) index]);
+        }
+
+        next.inputRms = inputRms + rmsCoefficient * (levels.inputRms - inputRms);
+        next.outputRms = outputRms + rmsCoefficient * (levels.outputRms - outputRms);
+
+        if (differsVisibly(next, levels))
+        {
+            levels = next;
+            repaint();
+        }
+    }
+
+    //==============================================================================
+    void paint (juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().reduced(4);
+        auto labels = area.removeFromBottom(28);
+        auto numBars = 2 + levels.numGainReductions;
+        auto barWidth = area.getWidth() / juce::jmax(1, numBars);
+
+        g.setFont(11.0f);
+
+        auto drawLabel = [&] (int bar, const juce::String& name, const juce::String& value)
+        {
+            auto label = labels.withX(area.getX() + bar * barWidth).withWidth(barWidth);
+            g.setColour(juce::Colours::lightgrey);
+            g.drawFittedText(name, label.removeFromTop(14), juce::Justification::centred, 1);
+            g.drawFittedText(value, label, juce::Justification::centred, 1);
+        };
+
+        auto drawLevel = [&] (int bar, const juce::String& name, float peak, float rms)
+        {
+            auto column = area.withX(area.getX() + bar * barWidth).withWidth(barWidth).reduced(3, 0).toFloat();
+            g.setColour(juce::Colours::black.withAlpha(0.4f));
+            g.fillRect(column);
+
+            g.setColour(juce::Colours::seagreen);
+            g.fillRect(column.withTop(column.getBottom() - column.getHeight() * proportionOf(rms)));
+
+            auto peakY = column.getBottom() - column.getHeight() * proportionOf(peak);
+            g.setColour(peak > 1.0f ? juce::Colours::red : juce::Colours::lightgreen);
+            g.fillRect(column.withTop(peakY).withHeight(2.0f));
+
+            drawLabel(bar, name, decibelText(juce::Decibels::gainToDecibels(peak, minDecibels)));
+        };
+
+        drawLevel(0, "In", levels.inputPeak, levels.inputRms);
+        drawLevel(1, "Out", levels.outputPeak, levels.outputRms);
+
+        for (int index = 0; index < levels.numGainReductions; ++index)
+        {
+            auto gr = levels.gainReduction[(size_t) index];
+            auto column = area.withX(area.getX() + (2 + index) * barWidth).withWidth(barWidth).reduced(3, 0).toFloat();
+
+            g.setColour(juce::Colours::black.withAlpha(0.4f));
+            g.fillRect(column);
+
+            g.setColour(juce::Colours::orange);
+            g.fillRect(column.withHeight(column.getHeight() * juce::jlimit(0.0f, 1.0f, gr / maxGainReductionDecibels)));
+
+            drawLabel(2 + index, index < gainReductionNames.size() ? gainReductionNames[index] : "GR " + juce::String(index + 1),
+                      decibelText(-gr));
+        }
+    }
+
+private:
+    //==============================================================================
+    static constexpr float minDecibels = -60.0f, maxDecibels = 6.0f;
+    static constexpr float maxGainReductionDecibels = 24.0f;
+
+    struct Levels
+    {
+        float inputPeak = 0.0f, inputRms = 0.0f, outputPeak = 0.0f, outputRms = 0.0f;
+        int numGainReductions = 0;
+        std::array<float, LevelMeters::maxGainReductions> gainReduction {};
+    };
+
+    static float proportionOf (float gain) noexcept
+    {
+        auto decibels = juce::Decibels::gainToDecibels(gain, minDecibels);
+        return juce::jlimit(0.0f, 1.0f, (decibels - minDecibels) / (maxDecibels - minDecibels));
+    }
+
+    static juce::String decibelText (float decibels)
+    {
+        return decibels <= minDecibels ? juce::String("-inf") : juce::String(decibels, 1);
+    }
+
+    // a tenth of a dB, or anything that changes the layout
+    static bool differsVisibly (const Levels& a, const Levels& b) noexcept
+    {
+        auto moved = [] (float x, float y) { return std::abs(juce::Decibels::gainToDecibels(x, minDecibels)
+                                                            - juce::Decibels::gainToDecibels(y, minDecibels)) > 0.1f; };
+
+        if (a.numGainReductions != b.numGainReductions
+             || moved(a.inputPeak, b.inputPeak) || moved(a.inputRms, b.inputRms)
+             || moved(a.outputPeak, b.outputPeak) || moved(a.outputRms, b.outputRms))
+            return true;
+
+        for (int index = 0; index < a.numGainReductions; ++index)
+            if (std::abs(a.gainReduction[(size_t) index] - b.gainReduction[(size_t) index]) > 0.1f)
+                return true;
+
+        return false;
+    }
+
+    Levels levels;
+    juce::StringArray gainReductionNames;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterView)
+};
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.h
+
+    A linear ramp for a parameter that writes its values out a whole array
+    at a time, instead of being asked for one value per sample.
+
+    juce::SmoothedValue hands out one value per getNextValue() call, each one
+    depending on the last, so filling a tile with it is a scalar loop with a
+    branch per sample. Here every value is start + step * (i + 1), with no
+    value depending on the one before, so the fill goes through
+    KernelDispatch::forEachSample and vectorises like the other kernels.
+    A ramp that isn't moving is a single fill of its target.
+
+    Gains are ramped in decibels, so that everything derived from one
+    parameter (SmartClip's threshold, input gain and makeup gain all come
+    from Preserve) moves in step with it and with each other. fillGain()
+    converts to linear gain exactly at the ends of the array and
+    interpolates between them, which over a tile of 64 samples stays within
+    a few hundredths of a dB of converting every sample.
+
+        ramp.reset (sampleRate, 0.05);      // prepareToPlay
+        ramp.setTarget (decibels);          // whenever the parameter moves
+        ramp.fillGain (isa, gains, n);      // per tile, moves the ramp on by n
+
+    It is a plain value type, so the worker groups each copy it and walk their
+    own copy through the block, as they did with SmoothedValue.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "KernelDispatch.h"
+
+//==============================================================================
+class ParameterRamp
+{
+public:
+    ParameterRamp() = default;
+
+    /** Sets how long a ramp takes and jumps to the target, from prepareToPlay. */
+    void reset (double sampleRate, double rampSeconds) noexcept
+    {
+        rampLength = juce::jmax(0, (int) std::floor(rampSeconds * sampleRate));
+        setCurrentAndTarget(target);
+    }
+
+    /** Jumps straight to a value, with no ramp. */
+    void setCurrentAndTarget (float newValue) noexcept
+    {
+        current = target = newValue;
+        step = 0.0f;
+        remaining = 0;
+    }
+
+    /** Ramps from wherever the ramp is now to newTarget. */
+    void setTarget (float newTarget) noexcept
+    {
+        if (newTarget == target)
+            return;
+
+        if (rampLength == 0)
+        {
+            setCurrentAndTarget(newTarget);
+            return;
+        }
+
+        target = newTarget;
+        remaining = rampLength;
+        step = (target - current) / (float) remaining;
+    }
+
+    float getCurrentValue() const noexcept      { return current; }
+    float getTargetValue() const noexcept       { return target; }
+    bool isRamping() const noexcept             { return remaining > 0; }
+
+    //==============================================================================
+    /** Moves the ramp on by numSamples without writing anything. */
+    void skip (int numSamples) noexcept
+    {
+        if (numSamples >= remaining)
+        {
+            setCurrentAndTarget(target);
+            return;
+        }
+
+        current += step * (float) numSamples;
+        remaining -= numSamples;
+    }
+
+    /** Writes the next numSamples values into dest and moves the ramp on by
+        that many. With valuesPerSample above 1 it writes that many values for
+        every sample, evenly spaced, for a stage running oversampled: dest then
+        needs room for numSamples * valuesPerSample.
+    */
+    void fill (KernelDispatch::Isa isa, float* dest, int numSamples, int valuesPerSample = 1) noexcept
+    {
+        auto numValues = numSamples * valuesPerSample;
+        auto numRamping = juce::jmin(numValues, remaining * valuesPerSample);
+
+        if (numRamping > 0)
+        {
+            auto start = current;
+            auto increment = step / (float) valuesPerSample;
+
+            KernelDispatch::forEachSample(isa, numRamping, [=] (int i) { dest[i] = start + increment * (float) (i + 1); });
+        }
+
+        juce::FloatVectorOperations::fill(dest + numRamping, target, numValues - numRamping);
+        skip(numSamples);
+    }
+
+    /** For a ramp in decibels, writes the next numSamples values into dest as
+        linear gains and moves the ramp on by that many. Meant for a tile at a
+        time, see the top of the file.
+    */
+    void fillGain (KernelDispatch::Isa isa, float* dest, int numSamples) noexcept
+    {
+        auto numRamping = juce::jmin(numSamples, remaining);
+        auto targetGain = toGain(target);
+
+        if (numRamping > 0)
+        {
+            auto startGain = toGain(current);
+            auto endGain = numRamping == remaining ? targetGain : toGain(current + step * (float) numRamping);
+            auto increment = (endGain - startGain) / (float) numRamping;
+
+            KernelDispatch::forEachSample(isa, numRamping, [=] (int i) { dest[i] = startGain + increment * (float) (i + 1); });
+        }
+
+        juce::FloatVectorOperations::fill(dest + numRamping, targetGain, numSamples - numRamping);
+        skip(numSamples);
+    }
+
+    static float toGain (float decibels) noexcept   { return juce::Decibels::decibelsToGain(decibels, -200.0f); }
+
+private:
+    //==============================================================================
+    float current = 0.0f, target = 0.0f, step = 0.0f;
+    int remaining = 0, rampLength = 0;
+};
@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    ProcessorHelpers.h
+
+    Small helpers both plugin processors use, kept in one place.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace ProcessorHelpers
+{
+    /** Maps value from the range start1 - end1 onto start2 - end2, linearly and
+        without clamping. Either range can run downwards.
+    */
+    constexpr float remap (float value, float start1, float end1, float start2, float end2) noexcept
+    {
+        return start2 + (end2 - start2) * ((value - start1) / (end1 - start1));
+    }
+
+    /** Both processors work through every host block in sub-blocks of at most
+        this many samples, and read their parameters again before each one. So
+        automation lands within this many samples of where the host put it, and
+        the scratch each stage works on stays in L1, whatever block size the
+        host picks.
+    */
+    constexpr int subBlockSize = 64;
+
+    /** Calls fn(start, length) for each sub-block of a block of numSamples, in order. */
+    template <typename Fn>
+    void forEachSubBlock (int numSamples, Fn&& fn)
+    {
+        for (int start = 0; start < numSamples; start += subBlockSize)
+            fn(start, juce::jmin(subBlockSize, numSamples - start));
+    }
+
+    /** A buffer pointing into the first numChannels channels of buffer, from start
+        for length samples. Nothing is copied, and up to 32 channels nothing is
+        allocated either.
+    */
+    template <typename Sample>
+    juce::AudioBuffer<Sample> subBuffer (juce::AudioBuffer<Sample>& buffer, int numChannels, int start, int length) noexcept
+    {
+        jassert(numChannels >= 0 && numChannels <= buffer.getNumChannels() && start + length <= buffer.getNumSamples());
+        return juce::AudioBuffer<Sample>(buffer.getArrayOfWritePointers(), numChannels, start, length);
+    }
+}
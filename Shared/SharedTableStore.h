@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    SharedTableStore.h
+
+    One copy of each read only table for the whole process, however many
+    plugin instances use it.
+
+    Tables (curve lookup tables, filter kernels, coefficient sets) are keyed
+    by what they were built for: an id naming the kind of table, and the
+    exponent, sample rate and quality it depends on, each left at 0 when it
+    doesn't. The first instance to ask for a key builds the table, and every
+    instance after it gets the same immutable copy. The store only holds weak
+    references, so a table is freed when the last instance using it goes,
+    and built again if one comes back.
+
+    get() locks and may build, so call it from prepareToPlay or the
+    constructor, never from the audio thread. Keep the shared_ptr it returns
+    as a member; reading the table through it needs no locking at all.
+
+    Processors hold a juce::SharedResourcePointer<SharedTableStore>, so the
+    store itself lives exactly as long as some instance does.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+class SharedTableStore
+{
+public:
+    struct Key
+    {
+        juce::String id;
+        double exponent = 0.0;
+        double sampleRate = 0.0;
+        int quality = 0;
+
+        bool operator< (const Key& other) const noexcept
+        {
+            return std::tie(id, exponent, sampleRate, quality) < std::tie(other.id, other.exponent, other.sampleRate, other.quality);
+        }
+    };
+
+    struct Stats
+    {
+        int numTables = 0;                  // alive right now
+        int numReferences = 0;              // instances holding one of them
+        size_t numBytes = 0;                // what the live tables take up
+        size_t numBytesSaved = 0;           // what a copy per instance would have taken on top
+        juce::int64 numBuilds = 0, numHits = 0;
+        double buildSeconds = 0.0;          // spent building, since the store was created
+    };
+
+    SharedTableStore() = default;
+
+    //==============================================================================
+    /** Returns the table for key, calling build() to make it if no instance
+        holds one. build returns a std::shared_ptr<Table>, and Table has a
+        getMemoryUsage() returning its size in bytes.
+    */
+    template <typename Table, typename Builder>
+    std::shared_ptr<const Table> get (const Key& key, Builder&& build)
+    {
+        const juce::ScopedLock sl (lock);
+
+        if (sharingEnabled)
+        {
+            if (auto found = entries.find(key); found != entries.end())
+            {
+                if (auto table = found->second.table.lock())
+                {
+                    ++numHits;
+                    return std::static_pointer_cast<const Table>(table);
+                }
+            }
+        }
+
+        auto start = juce::Time::getMillisecondCounterHiRes();
+        std::shared_ptr<const Table> table = build();
+        buildSeconds += (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+        ++numBuilds;
+
+        if (sharingEnabled)
+            entries[key] = { table, table->getMemoryUsage() };
+
+        removeExpired();
+        return table;
+    }
+
+    /** Off, every get() builds a copy of its own, as if there were no store.
+        For measuring what the sharing saves.
+    */
+    void setSharingEnabled (bool shouldShare)
+    {
+        const juce::ScopedLock sl (lock);
+        sharingEnabled = shouldShare;
+    }
+
+    //==============================================================================
+    Stats getStats() const
+    {
+        const juce::ScopedLock sl (lock);
+        Stats stats;
+
+        for (auto& [key, entry] : entries)
+        {
+            // the instances holding it, the store's own weak reference doesn't count
+            auto references = (int) entry.table.use_count();
+
+            if (references == 0)
+                continue;
+
+            ++stats.numTables;
+            stats.numReferences += references;
+            stats.numBytes += entry.numBytes;
+            stats.numBytesSaved += entry.numBytes * (size_t) (references - 1);
+        }
+
+        stats.numBuilds = numBuilds;
+        stats.numHits = numHits;
+        stats.buildSeconds = buildSeconds;
+        return stats;
+    }
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        std::weak_ptr<const void> table;
+        size_t numBytes = 0;
+    };
+
+    void removeExpired()
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+            it = it->second.table.expired() ? entries.erase(it) : std::next(it);
+    }
+
+    juce::CriticalSection lock;
+    std::map<Key, Entry> entries;
+    bool sharingEnabled = true;
+    juce::int64 numBuilds = 0, numHits = 0;
+    double buildSeconds = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE (SharedTableStore)
+};
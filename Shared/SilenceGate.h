@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    SilenceGate.h
+
+    Lets a processor go to sleep while its input is silent, and skip its
+    whole chain until signal comes back.
+
+    A silent input doesn't mean a silent output straight away: the filters
+    ring on, the limiters release, gain ramps finish and the oversampling
+    and lookahead delays still hold the last of the signal. So a processor
+    keeps running on silence until the gate has seen at least the tail
+    length of it and the processor reports that its state has died away
+    below silenceThreshold. It then clears that state and sleeps, writing
+    silence without touching the chain.
+
+    It wakes on the first block that has anything above silenceThreshold on
+    its input. The state was cleared on the way to sleep, so the chain run
+    over that block from its first sample gives the same output as one that
+    never slept, to within what the cleared state held.
+
+        if (gate.skipBlock (SilenceGate::isSilent (buffer, numChannels), numSamples))
+            clear the output, advance the gain ramps and return
+        ... process ...
+        if (gate.isWaitingToSleep() && the output and state have decayed)
+            reset the state, then gate.sleep()
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class SilenceGate
+{
+public:
+    /** -140 dBFS. Input below this counts as silence, and state below it as decayed. */
+    static constexpr float silenceThreshold = 1.0e-7f;
+
+    SilenceGate() = default;
+
+    //==============================================================================
+    /** From prepareToPlay or whenever the latency changes. At least this many
+        silent samples have to go through before the gate will sleep.
+    */
+    void setTailSamples (int numSamples) noexcept   { tailSamples = juce::jmax(0, numSamples); }
+
+    /** Any thread. A disabled gate never sleeps, for comparing against one that does. */
+    void setEnabled (bool shouldBeEnabled) noexcept { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const noexcept                 { return enabled.load(std::memory_order_relaxed); }
+
+    /** Wakes up and starts counting again, for prepareToPlay and reset(). */
+    void reset() noexcept
+    {
+        silentSamples = 0;
+        sleeping = false;
+    }
+
+    //==============================================================================
+    /** True if every one of the first numChannels channels stays below silenceThreshold. */
+    template <typename Sample>
+    static bool isSilent (const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            if (buffer.getMagnitude(channel, 0, buffer.getNumSamples()) >= (Sample) silenceThreshold)
+                return false;
+
+        return true;
+    }
+
+    /** Call at the top of every block. Returns true while asleep, when the
+        block should be skipped, and wakes on any input that isn't silent.
+    */
+    bool skipBlock (bool inputSilent, int numSamples) noexcept
+    {
+        if (! inputSilent || ! isEnabled())
+        {
+            reset();
+            return false;
+        }
+
+        if (sleeping)
+            return true;
+
+        silentSamples = juce::jmin(silentSamples + numSamples, std::numeric_limits<int>::max() / 2);
+        return false;
+    }
+
+    /** After processing a block: true once enough silence has gone through
+        that it is worth the processor checking whether its state has decayed.
+    */
+    bool isWaitingToSleep() const noexcept      { return ! sleeping && silentSamples >= tailSamples && silentSamples > 0; }
+
+    /** The processor has checked its state has decayed and is about to clear it. */
+    void sleep() noexcept                       { sleeping = true; }
+
+    bool isSleeping() const noexcept            { return sleeping; }
+
+private:
+    //==============================================================================
+    std::atomic<bool> enabled { true };
+    int tailSamples = 0;
+    int silentSamples = 0;
+    bool sleeping = false;
+
+    JUCE_DECLARE_NON_COPYABLE (SilenceGate)
+};
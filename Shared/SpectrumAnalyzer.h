@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.h
+
+    The spectrum of a processor's input and output, worked out on a thread of
+    its own for the editor to draw.
+
+    The audio thread only mixes each block down to mono and pushes it into a
+    ring, one for the input and one for the output. Nothing is pushed unless
+    an editor has called setActive (true).
+
+    The worker wakes once per display frame, moves whatever has arrived into
+    a history of the last fftSize samples, and runs one Hann windowed FFT
+    over that history for each signal. Successive windows overlap by however
+    much of the history is older than a frame (about 60% at 48 kHz and
+    30 frames a second), and the magnitudes are smoothed with a one pole in
+    dB, so the cost goes with the frame rate and not with the host's block
+    size or sample rate. The finished spectra go back to the editor through
+    another ring.
+
+    The rings and histories come to a few hundred KB, which a session of
+    instances with no editor open would never use. So they are only
+    allocated, on the message thread, the first time an editor calls
+    setActive (true), and handed to the audio thread through an atomic
+    pointer. Once allocated they stay until the analyzer is destroyed, so
+    the audio thread never sees them go.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpscRing.h"
+
+//==============================================================================
+class SpectrumAnalyzer : private juce::Thread
+{
+public:
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBins = fftSize / 2 + 1;
+
+    /** One display frame, in dB relative to a full scale sine. */
+    struct Spectrum
+    {
+        double sampleRate = 44100.0;
+        std::array<float, numBins> input {}, output {};
+    };
+
+    SpectrumAnalyzer() : juce::Thread("Spectrum analyzer") {}
+    ~SpectrumAnalyzer() override    { setActive(false); }
+
+    //==============================================================================
+    /** From prepareToPlay. */
+    void prepare (double sampleRate) noexcept       { currentSampleRate.store(sampleRate); }
+
+    /** Audio thread. Read it once per block and skip the pushes when it is false. */
+    bool isActive() const noexcept                  { return active.load(std::memory_order_relaxed); }
+
+    template <typename Sample>
+    void pushInput (const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+    {
+        if (auto* b = published.load(std::memory_order_acquire))
+            push(b->inputSamples, buffer, numChannels);
+    }
+
+    template <typename Sample>
+    void pushOutput (const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+    {
+        if (auto* b = published.load(std::memory_order_acquire))
+            push(b->outputSamples, buffer, numChannels);
+    }
+
+    //==============================================================================
+    /** Editor side. Starts or stops the worker, which then runs framesPerSecond
+        FFTs of each signal a second.
+    */
+    void setActive (bool shouldBeActive, int framesPerSecond = 30)
+    {
+        if (! shouldBeActive)
+        {
+            active.store(false, std::memory_order_relaxed);
+            stopThread(1000);
+            return;
+        }
+
+        if (isThreadRunning())
+            stopThread(1000);
+
+        if (buffers == nullptr)
+        {
+            buffers = std::make_unique<Buffers>();
+            published.store(buffers.get(), std::memory_order_release);
+        }
+
+        // the worker isn't running, so this thread can act as both readers
+        frameInterval = 1000 / juce::jmax(1, framesPerSecond);
+        buffers->inputSamples.clear();
+        buffers->outputSamples.clear();
+        buffers->spectra.clear();
+        buffers->input.reset();
+        buffers->output.reset();
+
+        active.store(true, std::memory_order_relaxed);
+        startThread(juce::Thread::Priority::low);
+    }
+
+    /** Editor side. Copies out the newest spectrum and returns true if there
+        was one since the last call.
+    */
+    bool getLatest (Spectrum& spectrum) noexcept
+    {
+        auto found = false;
+
+        if (buffers == nullptr)
+            return false;
+
+        while (buffers->spectra.pop(spectrum))
+            found = true;
+
+        return found;
+    }
+
+private:
+    //==============================================================================
+    using SampleRing = SpscRing<float, 32768>;
+
+    // the mono mix is made in chunks of this many samples on the stack
+    static constexpr int chunkSize = 256;
+
+    template <typename Sample>
+    static void push (SampleRing& ring, const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+    {
+        if (numChannels <= 0)
+            return;
+
+        std::array<float, chunkSize> mono;
+        auto scale = 1.0f / (float) numChannels;
+
+        for (int start = 0; start < buffer.getNumSamples(); start += chunkSize)
+        {
+            auto n = juce::jmin(chunkSize, buffer.getNumSamples() - start);
+            std::fill(mono.begin(), mono.begin() + n, 0.0f);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* data = buffer.getReadPointer(channel, start);
+
+                for (int i = 0; i < n; ++i)
+                    mono[(size_t) i] += (float) data[i];
+            }
+
+            juce::FloatVectorOperations::multiply(mono.data(), scale, n);
+
+            // a full ring only leaves a gap in the history, which the display shrugs off
+            ring.push(mono.data(), n);
+        }
+    }
+
+    //==============================================================================
+    // the worker's side of one signal
+    struct Analysis
+    {
+        std::array<float, fftSize> history {};
+        int writePosition = 0;
+        std::array<float, numBins> smoothed {};
+
+        void reset() noexcept
+        {
+            history.fill(0.0f);
+            writePosition = 0;
+            smoothed.fill(minDecibels);
+        }
+
+        void drain (SampleRing& ring) noexcept
+        {
+            // straight into the history, a contiguous run at a time
+            for (;;)
+            {
+                auto numPopped = ring.pop(history.data() + writePosition, fftSize - writePosition);
+
+                if (numPopped == 0)
+                    break;
+
+                writePosition = (writePosition + numPopped) % fftSize;
+            }
+        }
+    };
+
+    void run() override
+    {
+        juce::dsp::FFT fft(fftOrder);
+        juce::dsp::WindowingFunction<float> window((size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false);
+        std::vector<float> fftData((size_t) fftSize * 2);
+        Spectrum spectrum;
+
+        // a full scale sine comes out of the windowed transform at fftSize / 4
+        const auto normalisation = 4.0f / (float) fftSize;
+        auto lastFrame = juce::Time::getMillisecondCounterHiRes();
+
+        auto analyse = [&] (Analysis& analysis, std::array<float, numBins>& result, float smoothing)
+        {
+            // oldest sample first
+            auto oldest = analysis.history.begin() + analysis.writePosition;
+            std::copy(oldest, analysis.history.end(), fftData.begin());
+            std::copy(analysis.history.begin(), oldest, fftData.begin() + (analysis.history.end() - oldest));
+
+            window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+            fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+            for (size_t bin = 0; bin < (size_t) numBins; ++bin)
+            {
+                auto decibels = juce::Decibels::gainToDecibels(fftData[bin] * normalisation, minDecibels);
+                auto& value = analysis.smoothed[bin];
+                value = decibels + smoothing * (value - decibels);
+                result[bin] = value;
+            }
+        };
+
+        // setActive() allocates these before starting the thread
+        auto& b = *buffers;
+
+        while (! threadShouldExit())
+        {
+            b.input.drain(b.inputSamples);
+            b.output.drain(b.outputSamples);
+
+            // the same 150 ms time constant however long the frame actually took
+            auto now = juce::Time::getMillisecondCounterHiRes();
+            auto smoothing = (float) std::exp(-(now - lastFrame) * 0.001 / 0.15);
+            lastFrame = now;
+
+            spectrum.sampleRate = currentSampleRate.load();
+            analyse(b.input, spectrum.input, smoothing);
+            analyse(b.output, spectrum.output, smoothing);
+
+            // the editor reads the newest, so a full ring only skips a frame
+            b.spectra.push(spectrum);
+
+            wait(frameInterval);
+        }
+    }
+
+    static constexpr float minDecibels = -120.0f;
+
+    std::atomic<bool> active { false };
+    std::atomic<double> currentSampleRate { 44100.0 };
+    int frameInterval = 33;
+
+    // everything that only an open editor needs, see the top of the file
+    struct Buffers
+    {
+        SampleRing inputSamples, outputSamples;
+        Analysis input, output;
+        SpscRing<Spectrum, 4> spectra;
+    };
+
+    std::unique_ptr<Buffers> buffers;
+    std::atomic<Buffers*> published { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE (SpectrumAnalyzer)
+};
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    SpectrumView.h
+
+    Draws a SpectrumAnalyzer's input and output spectra on a log frequency
+    axis, with optional markers such as crossover frequencies.
+
+    update() takes the newest spectrum, if there is one, and turns it into a
+    path with one point per pixel column. The grid is rendered into an Image
+    when the component is resized, so a frame only costs the two paths.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumAnalyzer.h"
+
+//==============================================================================
+class SpectrumView : public juce::Component
+{
+public:
+    SpectrumView() = default;
+
+    /** Frequencies in Hz, drawn as dashed vertical lines. */
+    void setMarkers (std::vector<float> newMarkers)
+    {
+        markers = std::move(newMarkers);
+        repaint();
+    }
+
+    /** Takes the newest spectrum from the analyzer, and repaints if there was one. */
+    void update (SpectrumAnalyzer& analyzer)
+    {
+        if (! analyzer.getLatest(spectrum))
+            return;
+
+        sampleRate = (float) spectrum.sampleRate;
+        inputPath = createPath(spectrum.input, true);
+        outputPath = createPath(spectrum.output, false);
+        repaint();
+    }
+
+    //==============================================================================
+    void paint (juce::Graphics& g) override
+    {
+        g.drawImageAt(grid, 0, 0);
+
+        g.setColour(juce::Colours::grey.withAlpha(0.5f));
+        g.fillPath(inputPath);
+
+        g.setColour(juce::Colours::orange);
+        g.strokePath(outputPath, juce::PathStrokeType(1.5f));
+
+        const float dashes[] = { 3.0f, 3.0f };
+        g.setColour(juce::Colours::skyblue.withAlpha(0.7f));
+
+        for (auto frequency : markers)
+        {
+            auto x = frequencyToX(frequency);
+            g.drawDashedLine({ x, plotArea.getY(), x, plotArea.getBottom() }, dashes, 2);
+        }
+    }
+
+    void resized() override
+    {
+        plotArea = getLocalBounds().toFloat().reduced(4.0f);
+        plotArea.removeFromBottom(14.0f);
+        renderGrid();
+    }
+
+private:
+    //==============================================================================
+    static constexpr float minFrequency = 20.0f, maxFrequency = 20000.0f;
+    static constexpr float minDecibels = -90.0f, maxDecibels = 6.0f;
+
+    float frequencyToX (float frequency) const noexcept
+    {
+        auto proportion = std::log(frequency / minFrequency) / std::log(maxFrequency / minFrequency);
+        return plotArea.getX() + plotArea.getWidth() * proportion;
+    }
+
+    float decibelsToY (float decibels) const noexcept
+    {
+        auto proportion = (juce::jlimit(minDecibels, maxDecibels, decibels) - minDecibels) / (maxDecibels - minDecibels);
+        return plotArea.getBottom() - plotArea.getHeight() * proportion;
+    }
+
+    // one point per pixel column, the loudest of the bins that fall into it
+    juce::Path createPath (const std::array<float, SpectrumAnalyzer::numBins>& decibels, bool filled) const
+    {
+        juce::Path path;
+        auto width = juce::roundToInt(plotArea.getWidth());
+
+        if (width <= 1)
+            return path;
+
+        auto binsPerHertz = (float) SpectrumAnalyzer::fftSize / sampleRate;
+        auto ratio = maxFrequency / minFrequency;
+
+        auto binAt = [&] (int column)
+        {
+            auto frequency = minFrequency * std::pow(ratio, (float) column / (float) width);
+            return juce::jlimit(0, SpectrumAnalyzer::numBins - 1, juce::roundToInt(frequency * binsPerHertz));
+        };
+
+        if (filled)
+            path.startNewSubPath(plotArea.getX(), plotArea.getBottom());
+
+        for (int column = 0; column < width; ++column)
+        {
+            auto first = binAt(column), last = juce::jmax(first, binAt(column + 1) - 1);
+            auto level = *std::max_element(decibels.begin() + first, decibels.begin() + last + 1);
+            auto point = juce::Point<float>(plotArea.getX() + (float) column, decibelsToY(level));
+
+            if (column == 0 && ! filled)
+                path.startNewSubPath(point);
+            else
+                path.lineTo(point);
+        }
+
+        if (filled)
+        {
+            path.lineTo(plotArea.getRight(), plotArea.getBottom());
+            path.closeSubPath();
+        }
+
+        return path;
+    }
+
+    void renderGrid()
+    {
+        if (getWidth() <= 0 || getHeight() <= 0)
+            return;
+
+        grid = juce::Image(juce::Image::ARGB, getWidth(), getHeight(), true);
+        juce::Graphics g(grid);
+
+        g.setColour(juce::Colours::black.withAlpha(0.4f));
+        g.fillRect(plotArea);
+
+        g.setFont(10.0f);
+
+        for (auto frequency : { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f })
+        {
+            auto x = frequencyToX(frequency);
+            g.setColour(juce::Colours::white.withAlpha(0.1f));
+            g.drawVerticalLine(juce::roundToInt(x), plotArea.getY(), plotArea.getBottom());
+
+            g.setColour(juce::Colours::lightgrey);
+            g.drawText(frequency >= 1000.0f ? juce::String(frequency / 1000.0f) + "k" : juce::String(frequency),
+                       juce::Rectangle<float>(x - 20.0f, plotArea.getBottom(), 40.0f, 14.0f), juce::Justification::centred);
+        }
+
+        for (auto decibels = 0.0f; decibels > minDecibels; decibels -= 24.0f)
+        {
+            auto y = decibelsToY(decibels);
+            g.setColour(juce::Colours::white.withAlpha(0.1f));
+            g.drawHorizontalLine(juce::roundToInt(y), plotArea.getX(), plotArea.getRight());
+
+            g.setColour(juce::Colours::lightgrey);
+            g.drawText(juce::String(juce::roundToInt(decibels)), juce::Rectangle<float>(plotArea.getX() + 2.0f, y, 30.0f, 12.0f),
+                       juce::Justification::centredLeft);
+        }
+    }
+
+    SpectrumAnalyzer::Spectrum spectrum;
+    float sampleRate = 44100.0f;
+    juce::Rectangle<float> plotArea;
+    juce::Path inputPath, outputPath;
+    juce::Image grid;
+    std::vector<float> markers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumView)
+};
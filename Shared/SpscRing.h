@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    SpscRing.h
+
+    A fixed size, wait-free ring for handing values from one thread to one
+    other, typically from the audio thread to a reader on the message
+    thread or a worker.
+
+    Neither side ever locks, allocates or waits: push() fails (and counts
+    the drop) when the ring is full rather than waiting for the reader, and
+    pop() fails when it is empty. T is copied in and out, so keep it small
+    and trivially copyable.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+template <typename T, int capacity>
+class SpscRing
+{
+public:
+    static_assert(capacity > 1 && (capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing copies its values, they must be trivially copyable");
+
+    SpscRing() = default;
+
+    //==============================================================================
+    /** Writer side. Returns false, dropping the value, when the ring is full. */
+    bool push (const T& value) noexcept
+    {
+        auto write = writeIndex.load(std::memory_order_relaxed);
+
+        if (write - readIndex.load(std::memory_order_acquire) >= (juce::uint32) capacity)
+        {
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        slots[(size_t) (write & mask)] = value;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Writer side. Pushes as many of the values as fit, and returns how many that was. */
+    int push (const T* values, int numValues) noexcept
+    {
+        auto write = writeIndex.load(std::memory_order_relaxed);
+        auto space = (int) ((juce::uint32) capacity - (write - readIndex.load(std::memory_order_acquire)));
+        auto numToPush = juce::jmin(numValues, space);
+
+        for (int i = 0; i < numToPush; ++i)
+            slots[(size_t) ((write + (juce::uint32) i) & mask)] = values[i];
+
+        if (numToPush < numValues)
+            numDropped.fetch_add(numValues - numToPush, std::memory_order_relaxed);
+
+        writeIndex.store(write + (juce::uint32) numToPush, std::memory_order_release);
+        return numToPush;
+    }
+
+    //==============================================================================
+    /** Reader side. Returns false when there is nothing to read. */
+    bool pop (T& value) noexcept
+    {
+        auto read = readIndex.load(std::memory_order_relaxed);
+
+        if (read == writeIndex.load(std::memory_order_acquire))
+            return false;
+
+        value = slots[(size_t) (read & mask)];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Reader side. Pops up to maxValues, and returns how many it got. */
+    int pop (T* values, int maxValues) noexcept
+    {
+        auto read = readIndex.load(std::memory_order_relaxed);
+        auto numToPop = juce::jmin(maxValues, (int) (writeIndex.load(std::memory_order_acquire) - read));
+
+        for (int i = 0; i < numToPop; ++i)
+            values[i] = slots[(size_t) ((read + (juce::uint32) i) & mask)];
+
+        readIndex.store(read + (juce::uint32) numToPop, std::memory_order_release);
+        return numToPop;
+    }
+
+    /** Reader side. Throws away everything waiting. */
+    void clear() noexcept
+    {
+        readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    //==============================================================================
+    /** Either side, a snapshot that may be out of date by the time it is used. */
+    int getNumReady() const noexcept
+    {
+        return (int) (writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire));
+    }
+
+    /** How many values push() has had to drop so far. */
+    juce::int64 getNumDropped() const noexcept      { return numDropped.load(std::memory_order_relaxed); }
+
+    static constexpr int getCapacity() noexcept     { return capacity; }
+
+private:
+    //==============================================================================
+    static constexpr juce::uint32 mask = (juce::uint32) capacity - 1;
+
+    // the indices only ever count up and wrap together, so write - read is the fill
+    // level. Each on its own cache line, as they are written from different threads.
+    alignas (64) std::atomic<juce::uint32> writeIndex { 0 };
+    alignas (64) std::atomic<juce::uint32> readIndex { 0 };
+    alignas (64) std::atomic<juce::int64> numDropped { 0 };
+
+    std::array<T, (size_t) capacity> slots {};
+
+    JUCE_DECLARE_NON_COPYABLE (SpscRing)
+};
@@ -0,0 +1,288 @@
+/*
+  ==============================================================================
+
+    StageTimer.h
+
+    Optional per-stage timing for processBlock, shared by both plugins.
+
+    Compiled in only when OMNI_STAGE_TIMING is defined to 1 (the headless
+    tools do this). Otherwise every call is an empty inline function, the
+    scopes disappear from the build and the ring below takes no memory.
+
+    Besides the ticks of the most recent block, each block is published as
+    a Record into a wait-free SPSC ring owned by the timer, so by each
+    processor instance: the ticks of every stage, the block size, how many
+    denormals turned up and the gain reduction of each limiter. A reader on
+    any one other thread drains it with pop() or drain(), and turns records
+    into a log line or JSON with toLogLine() / toVar(). The audio thread
+    never locks or allocates to publish, and if the reader falls behind the
+    newest records are dropped and counted.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpscRing.h"
+
+#ifndef OMNI_STAGE_TIMING
+ #define OMNI_STAGE_TIMING 0
+#endif
+
+#if OMNI_STAGE_TIMING && JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+class StageTimer
+{
+public:
+    static constexpr int maxStages = 8;
+    static constexpr int maxGainReductions = 8;
+    static constexpr int ringSize = 512;
+
+    /** One block, as published by endBlock(). */
+    struct Record
+    {
+        juce::int64 block = 0;          // counts blocks since the processor was created
+        int numSamples = 0, numChannels = 0;
+        std::array<juce::int64, maxStages> ticks {};
+        int denormals = 0;              // see addDenormals()
+        int numGainReductions = 0;
+        std::array<float, maxGainReductions> gainReduction {};     // dB, as positive numbers
+    };
+
+    /** The names are kept by pointer, so pass string literals. */
+    StageTimer (std::initializer_list<const char*> names) noexcept
+    {
+        jassert(names.size() <= (size_t) maxStages);
+
+        for (auto* name : names)
+            if (numStages < maxStages)
+                stageNames[(size_t) numStages++] = name;
+    }
+
+    //==============================================================================
+    int getNumStages() const noexcept                       { return numStages; }
+    const char* getStageName (int stage) const noexcept     { return stageNames[(size_t) stage]; }
+
+    /** Ticks spent in a stage during the most recent block. On x86 these are
+        TSC cycles, elsewhere juce::Time high resolution ticks.
+    */
+    juce::int64 getTicks (int stage) const noexcept         { return ticks[(size_t) stage]; }
+
+    static constexpr bool isEnabled() noexcept              { return OMNI_STAGE_TIMING != 0; }
+
+    //==============================================================================
+    static juce::int64 now() noexcept
+    {
+       #if OMNI_STAGE_TIMING && JUCE_INTEL
+        return (juce::int64) __rdtsc();
+       #elif OMNI_STAGE_TIMING
+        return juce::Time::getHighResolutionTicks();
+       #else
+        return 0;
+       #endif
+    }
+
+    /** Call at the top of processBlock. */
+    void beginBlock() noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        ticks.fill(0);
+        pending.denormals = 0;
+        pending.numGainReductions = 0;
+       #endif
+    }
+
+    /** Call at the end of processBlock, publishes the block's record. */
+    void endBlock (int numSamples, int numChannels) noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        pending.block = numBlocks++;
+        pending.numSamples = numSamples;
+        pending.numChannels = numChannels;
+        pending.ticks = ticks;
+        records.push(pending);
+       #else
+        juce::ignoreUnused(numSamples, numChannels);
+       #endif
+    }
+
+    /** Denormals seen during the block, in the input or flushed out of filter state. */
+    void addDenormals (int count) noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        pending.denormals += count;
+       #else
+        juce::ignoreUnused(count);
+       #endif
+    }
+
+    /** The most gain reduction limiter index applied during the block, in dB. */
+    void setGainReduction (int index, float decibels) noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        if (index < maxGainReductions)
+        {
+            pending.gainReduction[(size_t) index] = decibels;
+            pending.numGainReductions = juce::jmax(pending.numGainReductions, index + 1);
+        }
+       #else
+        juce::ignoreUnused(index, decibels);
+       #endif
+    }
+
+    /** Counts subnormal samples by their bits, as comparisons read them as zero
+        once denormals are off. Only worth calling when isEnabled().
+    */
+    template <typename Sample>
+    static int countDenormals (const Sample* data, int numSamples) noexcept
+    {
+        using Bits = std::conditional_t<std::is_same_v<Sample, float>, juce::uint32, juce::uint64>;
+        constexpr auto exponentBits = std::is_same_v<Sample, float> ? (Bits) 0x7f800000 : (Bits) 0x7ff0000000000000;
+        constexpr auto mantissaBits = std::is_same_v<Sample, float> ? (Bits) 0x007fffff : (Bits) 0x000fffffffffffff;
+        int count = 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            Bits bits;
+            std::memcpy(&bits, data + i, sizeof (bits));
+            count += ((bits & exponentBits) == 0 && (bits & mantissaBits) != 0) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    void add (int stage, juce::int64 elapsed) noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        ticks[(size_t) stage] += elapsed;
+       #else
+        juce::ignoreUnused(stage, elapsed);
+       #endif
+    }
+
+    //==============================================================================
+    /** Reader side, from one thread other than the audio thread. Returns false
+        when there is nothing new, or the timer isn't compiled in.
+    */
+    bool pop (Record& record) noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        return records.pop(record);
+       #else
+        juce::ignoreUnused(record);
+        return false;
+       #endif
+    }
+
+    /** Reader side, calls fn for every record waiting and returns how many there were. */
+    template <typename Fn>
+    int drain (Fn&& fn)
+    {
+        int count = 0;
+
+        for (Record record; pop(record); ++count)
+            fn(record);
+
+        return count;
+    }
+
+    /** Records dropped because the reader didn't keep up. */
+    juce::int64 getNumDropped() const noexcept
+    {
+       #if OMNI_STAGE_TIMING
+        return records.getNumDropped();
+       #else
+        return 0;
+       #endif
+    }
+
+    /** A record as a JSON object, with the stages by name. Allocates. */
+    juce::var toVar (const Record& record) const
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("block", record.block);
+        object->setProperty("samples", record.numSamples);
+        object->setProperty("channels", record.numChannels);
+
+        auto* stages = new juce::DynamicObject();
+
+        for (int stage = 0; stage < numStages; ++stage)
+            stages->setProperty(stageNames[(size_t) stage], record.ticks[(size_t) stage]);
+
+        object->setProperty("ticks", juce::var(stages));
+        object->setProperty("denormals", record.denormals);
+
+        juce::Array<juce::var> gainReduction;
+
+        for (int index = 0; index < record.numGainReductions; ++index)
+            gainReduction.add(record.gainReduction[(size_t) index]);
+
+        object->setProperty("gainReduction", gainReduction);
+        return juce::var(object);
+    }
+
+    /** A record as one line of text for a log. Allocates. */
+    juce::String toLogLine (const Record& record) const
+    {
+        juce::String line;
+        line << "#" << record.block << " " << record.numSamples << " x " << record.numChannels << ":";
+
+        for (int stage = 0; stage < numStages; ++stage)
+            line << " " << stageNames[(size_t) stage] << " " << record.ticks[(size_t) stage];
+
+        if (record.denormals > 0)
+            line << ", " << record.denormals << " denormals";
+
+        if (record.numGainReductions > 0)
+        {
+            line << ", gr";
+
+            for (int index = 0; index < record.numGainReductions; ++index)
+                line << " " << juce::String(record.gainReduction[(size_t) index], 1);
+
+            line << " dB";
+        }
+
+        return line;
+    }
+
+    //==============================================================================
+    /** Adds the time until it goes out of scope to a stage. */
+    class Scope
+    {
+    public:
+       #if OMNI_STAGE_TIMING
+        Scope (StageTimer& t, int s) noexcept : timer (t), stage (s), start (now()) {}
+        ~Scope() noexcept       { timer.add(stage, now() - start); }
+
+    private:
+        StageTimer& timer;
+        int stage;
+        juce::int64 start;
+       #else
+        Scope (StageTimer&, int) noexcept {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+private:
+    //==============================================================================
+    std::array<const char*, maxStages> stageNames {};
+    std::array<juce::int64, maxStages> ticks {};
+    int numStages = 0;
+
+   #if OMNI_STAGE_TIMING
+    Record pending;
+    juce::int64 numBlocks = 0;
+    SpscRing<Record, ringSize> records;
+   #endif
+};
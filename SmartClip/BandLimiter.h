@@ -0,0 +1,472 @@
+/*
+  ==============================================================================
+
+    BandLimiter.h
+
+    The limiter SmartClip runs on each limited band, in place of
+    juce::dsp::Compressor with attack 0.
+
+    Everything stays in the linear domain. The envelope jumps straight to
+    any new peak and releases with the same one pole as
+    juce::dsp::BallisticsFilter, which is exactly what the compressor's
+    envelope does, in one branch free loop. The gain is the
+    compressor's  (envelope / threshold) ^ (1 / ratio - 1)  above the
+    threshold, worked out a tile at a time with SIMD log2 / exp2
+    approximations instead of std::pow per sample. The gain is within about
+    1e-6 of the compressor's, so the output nulls against it to well below
+    -100 dB (Benchmark checks this, see its "limiter null" line).
+
+    With lookahead the band's audio is delayed by that many samples, and the
+    envelope follows the peak over the last lookahead + 1 samples instead of
+    each sample, so the gain is already down when a peak comes out and no
+    sample gets out above the threshold. The delay is the only latency it adds.
+
+    The audio is Sample, float or double as the host processes, and is only
+    ever delayed and multiplied in that precision. The side chain (levels,
+    envelope and gain) is a control signal and stays in float either way.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if defined (__SSE2__) || defined (_M_X64) || defined (_M_AMD64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define OMNI_LIMITER_SSE2 1
+ #include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+ #define OMNI_LIMITER_NEON 1
+ #include <arm_neon.h>
+#endif
+
+//==============================================================================
+template <typename Sample>
+class BandLimiter
+{
+public:
+    BandLimiter() = default;
+
+    //==============================================================================
+    /** Allocates the delay lines, from prepareToPlay. */
+    void prepare (double newSampleRate, int numChannels, int maximumLookahead)
+    {
+        sampleRate = newSampleRate;
+        maxLookahead = juce::jmax(0, maximumLookahead);
+
+        channels.resize((size_t) numChannels);
+
+        for (auto& channel : channels)
+        {
+            channel.delayLine.assign((size_t) juce::jmax(1, maxLookahead), (Sample) 0);
+            channel.detector.window.allocate(maxLookahead);
+        }
+
+        linked.window.allocate(maxLookahead);
+
+        lookahead = juce::jmin(lookahead, maxLookahead);
+        setRelease(releaseMs);
+        reset();
+    }
+
+    /** Clears the envelopes and delay lines. */
+    void reset() noexcept
+    {
+        for (auto& channel : channels)
+        {
+            channel.detector.reset();
+            channel.delayPosition = 0;
+            std::fill(channel.delayLine.begin(), channel.delayLine.end(), (Sample) 0);
+        }
+
+        linked.reset();
+    }
+
+    //==============================================================================
+    void setThreshold (float decibels) noexcept
+    {
+        threshold = juce::Decibels::decibelsToGain(decibels, -200.0f);
+        thresholdInverse = 1.0f / threshold;
+    }
+
+    void setRatio (float ratio) noexcept            { exponent = 1.0f / ratio - 1.0f; }
+
+    void setRelease (float milliseconds) noexcept
+    {
+        // the same time constant as juce::dsp::BallisticsFilter
+        releaseMs = milliseconds;
+        release = milliseconds < 1.0e-3f || sampleRate <= 0.0 ? 0.0f
+                                                              : (float) std::exp(-2.0 * juce::MathConstants<double>::pi * 1000.0
+                                                                                 / (sampleRate * milliseconds));
+    }
+
+    /** In samples, up to the maximum given to prepare(). Clears the delay lines when it changes. */
+    void setLookahead (int samples) noexcept
+    {
+        samples = juce::jlimit(0, maxLookahead, samples);
+
+        if (samples != lookahead)
+        {
+            lookahead = samples;
+            reset();
+        }
+    }
+
+    int getLookahead() const noexcept               { return lookahead; }
+
+    //==============================================================================
+    /** Limits one channel in place with its own envelope, then applies outputGain. */
+    void process (int channel, Sample* data, const float* outputGain, int numSamples) noexcept
+    {
+        auto& state = channels[(size_t) channel];
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            auto length = juce::jmin(chunkSize, numSamples - start);
+            std::array<float, chunkSize> gains;
+
+            for (int i = 0; i < length; ++i)
+                gains[(size_t) i] = (float) std::abs(data[start + i]);
+
+            followEnvelope(state.detector, gains.data(), length);
+            computeGains(gains.data(), outputGain + start, length);
+            applyGains(state, data + start, gains.data(), length);
+        }
+    }
+
+    /** Limits every channel with one shared envelope that follows the loudest of them.
+        channelData[c] is channel c's data.
+    */
+    void processLinked (Sample* const* channelData, int numChannels, const float* outputGain, int numSamples) noexcept
+    {
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            auto length = juce::jmin(chunkSize, numSamples - start);
+            std::array<float, chunkSize> gains;
+            std::fill(gains.begin(), gains.begin() + length, 0.0f);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int i = 0; i < length; ++i)
+                    gains[(size_t) i] = juce::jmax(gains[(size_t) i], (float) std::abs(channelData[channel][start + i]));
+
+            followEnvelope(linked, gains.data(), length);
+            computeGains(gains.data(), outputGain + start, length);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                applyGains(channels[(size_t) channel], channelData[channel] + start, gains.data(), length);
+        }
+    }
+
+    /** Only delays a channel by the lookahead, for bands that aren't limited
+        but still have to line up with those that are.
+    */
+    void delay (int channel, Sample* data, int numSamples) noexcept
+    {
+        if (lookahead > 0)
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = pushPop(channels[(size_t) channel], data[i]);
+    }
+
+    /** The most gain reduction applied to any of the first numChannels channels
+        (or by the linked envelope) since the last call, in dB as a positive
+        number. Starts measuring again from here, so call it from the thread that
+        runs process(), after it.
+    */
+    float takeGainReduction (int numChannels) noexcept
+    {
+        auto peak = std::exchange(linked.peak, 0.0f);
+
+        for (int channel = 0; channel < juce::jmin(numChannels, (int) channels.size()); ++channel)
+            peak = juce::jmax(peak, std::exchange(channels[(size_t) channel].detector.peak, 0.0f));
+
+        // the gain is (envelope / threshold) ^ exponent, with exponent = 1 / ratio - 1 < 0
+        return peak > threshold ? -exponent * juce::Decibels::gainToDecibels(peak * thresholdInverse) : 0.0f;
+    }
+
+    /** The highest envelope of any channel or the linked detector, to tell when the
+        limiter has released. Call it from the thread that runs process().
+    */
+    float getEnvelopeMagnitude() const noexcept
+    {
+        auto magnitude = linked.envelope;
+
+        for (auto& channel : channels)
+            magnitude = juce::jmax(magnitude, channel.detector.envelope);
+
+        return magnitude;
+    }
+
+    //==============================================================================
+    /** log2 (x) for normal x > 0, to about 1e-7 relative. */
+    static float fastLog2 (float x) noexcept
+    {
+        juce::int32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+
+        // x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then log2 (m) from the atanh series
+        auto e = ((bits - 0x3f3504f3) >> 23);
+        bits -= (juce::int32) ((juce::uint32) e << 23);
+
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        auto s = (m - 1.0f) / (m + 1.0f), s2 = s * s;
+        return (float) e + s * (log2Coefficients[0] + s2 * (log2Coefficients[1] + s2 * (log2Coefficients[2] + s2 * log2Coefficients[3])));
+    }
+
+    /** 2^y for y in about [-126, 0], to about 1e-7. */
+    static float fastExp2 (float y) noexcept
+    {
+        auto i = std::floor(y);
+        auto z = (y - i - 0.5f) * ln2;
+
+        juce::int32 bits = ((juce::int32) i + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+
+        return scale * exp2Polynomial(z);
+    }
+
+private:
+    //==============================================================================
+    static constexpr int chunkSize = 64;
+    static constexpr float ln2 = 0.693147180559945f;
+
+    // 2 / ln 2 * (s + s^3 / 3 + s^5 / 5 + s^7 / 7)
+    static constexpr float log2Coefficients[4] = { 2.0f / ln2, 2.0f / (3.0f * ln2), 2.0f / (5.0f * ln2), 2.0f / (7.0f * ln2) };
+
+    // sqrt (2) * e^z for |z| <= ln 2 / 2, a Taylor series to z^6
+    static float exp2Polynomial (float z) noexcept
+    {
+        return 1.41421356f * (1.0f + z * (1.0f + z * (0.5f + z * (1.0f / 6.0f + z * (1.0f / 24.0f + z * (1.0f / 120.0f + z * (1.0f / 720.0f)))))));
+    }
+
+    /** The largest of the last lookahead + 1 levels, kept as a queue of the
+        levels that could still become the largest, in falling order.
+    */
+    struct PeakWindow
+    {
+        void allocate (int maximumLookahead)
+        {
+            levels.assign((size_t) maximumLookahead + 2, 0.0f);
+            times.assign((size_t) maximumLookahead + 2, 0);
+            reset();
+        }
+
+        void reset() noexcept       { first = 0; size = 0; now = 0; }
+
+        float push (float level, int lookahead) noexcept
+        {
+            auto capacity = (int) levels.size();
+
+            while (size > 0 && levels[(size_t) ((first + size - 1) % capacity)] <= level)
+                --size;
+
+            auto last = (first + size) % capacity;
+            levels[(size_t) last] = level;
+            times[(size_t) last] = now;
+            ++size;
+
+            // unsigned, so this still works when the sample count wraps
+            if (now - times[(size_t) first] > (juce::uint32) lookahead)
+            {
+                first = (first + 1) % capacity;
+                --size;
+            }
+
+            ++now;
+            return levels[(size_t) first];
+        }
+
+        std::vector<float> levels;
+        std::vector<juce::uint32> times;
+        int first = 0, size = 0;
+        juce::uint32 now = 0;
+    };
+
+    struct Detector
+    {
+        void reset() noexcept       { envelope = 0.0f; peak = 0.0f; window.reset(); }
+
+        float envelope = 0.0f;
+        float peak = 0.0f;          // the highest envelope since takeGainReduction()
+        PeakWindow window;
+    };
+
+    struct Channel
+    {
+        Detector detector;
+        std::vector<Sample> delayLine;
+        int delayPosition = 0;
+    };
+
+    Sample pushPop (Channel& channel, Sample input) noexcept
+    {
+        auto output = channel.delayLine[(size_t) channel.delayPosition];
+        channel.delayLine[(size_t) channel.delayPosition] = input;
+        channel.delayPosition = channel.delayPosition + 1 < lookahead ? channel.delayPosition + 1 : 0;
+        return output;
+    }
+
+    /** Turns the levels into the envelope, in place. Attack is instant, and
+        the release is the same one pole as juce::dsp::BallisticsFilter:
+        rising levels win the max, falling ones release towards the level.
+    */
+    void followEnvelope (Detector& detector, float* levels, int numSamples) const noexcept
+    {
+        if (lookahead > 0)
+            for (int i = 0; i < numSamples; ++i)
+                levels[i] = detector.window.push(levels[i], lookahead);
+
+        auto env = detector.envelope, peak = detector.peak;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto level = levels[i];
+            env = juce::jmax(level, level + release * (env - level));
+            levels[i] = env;
+            peak = juce::jmax(peak, env);
+        }
+
+        detector.envelope = env;
+        detector.peak = peak;
+    }
+
+    /** Envelope to gain, times outputGain, in place. */
+    void computeGains (float* envelope, const float* outputGain, int numSamples) const noexcept
+    {
+        int i = 0;
+
+       #if OMNI_LIMITER_SSE2
+        {
+            const auto one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+            const auto thresholdV = _mm_set1_ps(threshold), inverseV = _mm_set1_ps(thresholdInverse);
+            const auto exponentV = _mm_set1_ps(exponent), ln2V = _mm_set1_ps(ln2);
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                auto env = _mm_loadu_ps(envelope + i);
+                auto above = _mm_cmpge_ps(env, thresholdV);
+                auto ratio = _mm_max_ps(_mm_mul_ps(env, inverseV), one);
+
+                // log2 of the ratio, as in fastLog2
+                auto bits = _mm_castps_si128(ratio);
+                auto e = _mm_srai_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(0x3f3504f3)), 23);
+                auto m = _mm_castsi128_ps(_mm_sub_epi32(bits, _mm_slli_epi32(e, 23)));
+                auto s = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+                auto s2 = _mm_mul_ps(s, s);
+
+                auto poly = _mm_set1_ps(log2Coefficients[3]);
+                poly = _mm_add_ps(_mm_mul_ps(poly, s2), _mm_set1_ps(log2Coefficients[2]));
+                poly = _mm_add_ps(_mm_mul_ps(poly, s2), _mm_set1_ps(log2Coefficients[1]));
+                poly = _mm_add_ps(_mm_mul_ps(poly, s2), _mm_set1_ps(log2Coefficients[0]));
+                auto log2 = _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(s, poly));
+
+                // 2^y, as in fastExp2. y <= 0, so truncation rounds up and is corrected down
+                auto y = _mm_mul_ps(log2, exponentV);
+                auto truncated = _mm_cvttps_epi32(y);
+                auto i0 = _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmplt_ps(y, _mm_cvtepi32_ps(truncated))));
+                auto z = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(y, _mm_cvtepi32_ps(i0)), half), ln2V);
+                auto scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i0, _mm_set1_epi32(127)), 23));
+
+                auto p = _mm_set1_ps(1.0f / 720.0f);
+                p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f / 120.0f));
+                p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f / 24.0f));
+                p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.0f / 6.0f));
+                p = _mm_add_ps(_mm_mul_ps(p, z), half);
+                p = _mm_add_ps(_mm_mul_ps(p, z), one);
+                p = _mm_add_ps(_mm_mul_ps(p, z), one);
+                auto gain = _mm_mul_ps(_mm_mul_ps(scale, p), _mm_set1_ps(1.41421356f));
+
+                // below the threshold the gain is 1
+                gain = _mm_or_ps(_mm_and_ps(above, gain), _mm_andnot_ps(above, one));
+                _mm_storeu_ps(envelope + i, _mm_mul_ps(gain, _mm_loadu_ps(outputGain + i)));
+            }
+        }
+       #elif OMNI_LIMITER_NEON
+        {
+            const auto one = vdupq_n_f32(1.0f), half = vdupq_n_f32(0.5f);
+            const auto thresholdV = vdupq_n_f32(threshold), inverseV = vdupq_n_f32(thresholdInverse);
+            const auto exponentV = vdupq_n_f32(exponent), ln2V = vdupq_n_f32(ln2);
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                auto env = vld1q_f32(envelope + i);
+                auto above = vcgeq_f32(env, thresholdV);
+                auto ratio = vmaxq_f32(vmulq_f32(env, inverseV), one);
+
+                auto bits = vreinterpretq_s32_f32(ratio);
+                auto e = vshrq_n_s32(vsubq_s32(bits, vdupq_n_s32(0x3f3504f3)), 23);
+                auto m = vreinterpretq_f32_s32(vsubq_s32(bits, vshlq_n_s32(e, 23)));
+                auto mPlusOne = vaddq_f32(m, one);
+                auto reciprocal = vrecpeq_f32(mPlusOne);
+                reciprocal = vmulq_f32(vrecpsq_f32(mPlusOne, reciprocal), reciprocal);
+                reciprocal = vmulq_f32(vrecpsq_f32(mPlusOne, reciprocal), reciprocal);
+                auto s = vmulq_f32(vsubq_f32(m, one), reciprocal);
+                auto s2 = vmulq_f32(s, s);
+
+                auto poly = vdupq_n_f32(log2Coefficients[3]);
+                poly = vmlaq_f32(vdupq_n_f32(log2Coefficients[2]), poly, s2);
+                poly = vmlaq_f32(vdupq_n_f32(log2Coefficients[1]), poly, s2);
+                poly = vmlaq_f32(vdupq_n_f32(log2Coefficients[0]), poly, s2);
+                auto log2 = vmlaq_f32(vcvtq_f32_s32(e), s, poly);
+
+                auto y = vmulq_f32(log2, exponentV);
+                auto truncated = vcvtq_s32_f32(y);
+                auto i0 = vaddq_s32(truncated, vreinterpretq_s32_u32(vcltq_f32(y, vcvtq_f32_s32(truncated))));
+                auto z = vmulq_f32(vsubq_f32(vsubq_f32(y, vcvtq_f32_s32(i0)), half), ln2V);
+                auto scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(i0, vdupq_n_s32(127)), 23));
+
+                auto p = vdupq_n_f32(1.0f / 720.0f);
+                p = vmlaq_f32(vdupq_n_f32(1.0f / 120.0f), p, z);
+                p = vmlaq_f32(vdupq_n_f32(1.0f / 24.0f), p, z);
+                p = vmlaq_f32(vdupq_n_f32(1.0f / 6.0f), p, z);
+                p = vmlaq_f32(half, p, z);
+                p = vmlaq_f32(one, p, z);
+                p = vmlaq_f32(one, p, z);
+                auto gain = vmulq_f32(vmulq_f32(scale, p), vdupq_n_f32(1.41421356f));
+
+                gain = vbslq_f32(above, gain, one);
+                vst1q_f32(envelope + i, vmulq_f32(gain, vld1q_f32(outputGain + i)));
+            }
+        }
+       #endif
+
+        // scalar fallback and the leftover samples
+        for (; i < numSamples; ++i)
+        {
+            auto gain = envelope[i] < threshold ? 1.0f
+                                                : fastExp2(exponent * fastLog2(envelope[i] * thresholdInverse));
+            envelope[i] = gain * outputGain[i];
+        }
+    }
+
+    void applyGains (Channel& channel, Sample* data, const float* gains, int numSamples) noexcept
+    {
+        if (lookahead == 0)
+        {
+            if constexpr (std::is_same_v<Sample, float>)
+                juce::FloatVectorOperations::multiply(data, gains, numSamples);
+            else
+                for (int i = 0; i < numSamples; ++i)
+                    data[i] *= gains[i];
+
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            data[i] = pushPop(channel, data[i]) * gains[i];
+    }
+
+    //==============================================================================
+    double sampleRate = 0.0;
+    float threshold = 1.0f, thresholdInverse = 1.0f;
+    float exponent = 1.0f / 100.0f - 1.0f;
+    float releaseMs = 30.0f, release = 0.0f;
+    int lookahead = 0, maxLookahead = 0;
+
+    std::vector<Channel> channels;
+    Detector linked;
+
+    JUCE_DECLARE_NON_COPYABLE (BandLimiter)
+};
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    LinkwitzRileyLanes.h
+
+    juce::dsp::LinkwitzRileyFilter with the channels in SIMD lanes.
+
+    The filter is recursive, so it can't be vectorised along time, but every
+    channel runs the same sections with the same coefficients. So channels
+    are grouped into blocks as wide as juce::dsp::SIMDRegister<Sample> (4
+    floats or 2 doubles with SSE, twice that with AVX), the state of a
+    block lives in one register per state variable, and each processSample()
+    call moves every channel of the block on by one sample.
+
+    The arithmetic is the same as juce::dsp::LinkwitzRileyFilter's,
+    operation for operation, so each lane gives the same result as the
+    scalar filter would for that channel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+template <typename Sample, int maxChannels>
+class LinkwitzRileyLanes
+{
+public:
+    using Lanes = juce::dsp::SIMDRegister<Sample>;
+
+    static constexpr int laneWidth = (int) Lanes::SIMDNumElements;
+    static constexpr int maxBlocks = (maxChannels + laneWidth - 1) / laneWidth;
+
+    /** Channel c is lane c % laneWidth of block c / laneWidth. */
+    static constexpr int blockFor (int channel) noexcept     { return channel / laneWidth; }
+
+    //==============================================================================
+    LinkwitzRileyLanes() = default;
+
+    /** lowpass gives both bands from processSample (block, x, low, high), allpass
+        is the allpass both bands sum to, from processSample (block, x).
+    */
+    void setType (juce::dsp::LinkwitzRileyFilterType newType) noexcept
+    {
+        jassert(newType != juce::dsp::LinkwitzRileyFilterType::highpass);
+        allpass = newType == juce::dsp::LinkwitzRileyFilterType::allpass;
+    }
+
+    void prepare (const juce::dsp::ProcessSpec& spec) noexcept
+    {
+        jassert(spec.numChannels <= (juce::uint32) maxChannels);
+
+        sampleRate = spec.sampleRate;
+        update();
+        reset();
+    }
+
+    void setCutoffFrequency (Sample newCutoffFrequency) noexcept
+    {
+        jassert(newCutoffFrequency > 0);
+
+        cutoffFrequency = newCutoffFrequency;
+        update();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& state : states)
+            state.s1 = state.s2 = state.s3 = state.s4 = Lanes::expand((Sample) 0);
+    }
+
+    /** The largest state value in any lane, to tell when the filter has stopped ringing. */
+    Sample getStateMagnitude() const noexcept
+    {
+        Sample magnitude = 0;
+
+        for (auto& state : states)
+        {
+            for (auto* s : { &state.s1, &state.s2, &state.s3, &state.s4 })
+            {
+                alignas (sizeof (Lanes)) std::array<Sample, laneWidth> values;
+                s->copyToRawArray(values.data());
+
+                for (auto value : values)
+                    magnitude = juce::jmax(magnitude, std::abs(value));
+            }
+        }
+
+        return magnitude;
+    }
+
+    /** Flushes tiny state values to zero, once per block, as juce::dsp does.
+        Returns how many it flushed.
+    */
+    int snapToZero() noexcept
+    {
+        int numFlushed = 0;
+
+        for (auto& state : states)
+        {
+            for (auto* s : { &state.s1, &state.s2, &state.s3, &state.s4 })
+            {
+                alignas (sizeof (Lanes)) std::array<Sample, laneWidth> values;
+                s->copyToRawArray(values.data());
+
+                for (auto& value : values)
+                {
+                    auto before = value;
+                    juce::dsp::util::snapToZero(value);
+                    numFlushed += value != before ? 1 : 0;
+                }
+
+                *s = Lanes::fromRawArray(values.data());
+            }
+        }
+
+        return numFlushed;
+    }
+
+    //==============================================================================
+    /** Both bands for every lane of a block at once. */
+    void processSample (int block, Lanes input, Lanes& outputLow, Lanes& outputHigh) noexcept
+    {
+        auto& state = states[(size_t) block];
+
+        auto yH = (input - state.s1 * (R2 + g) - state.s2) * h;
+
+        auto yB = yH * g + state.s1;
+        state.s1 = yH * g + yB;
+
+        auto yL = yB * g + state.s2;
+        state.s2 = yB * g + yL;
+
+        auto yH2 = (yL - state.s3 * (R2 + g) - state.s4) * h;
+
+        auto yB2 = yH2 * g + state.s3;
+        state.s3 = yH2 * g + yB2;
+
+        auto yL2 = yB2 * g + state.s4;
+        state.s4 = yB2 * g + yL2;
+
+        outputLow = yL2;
+        outputHigh = yL - yB * R2 + yH - yL2;
+    }
+
+    /** The allpass, for every lane of a block at once. */
+    Lanes processSample (int block, Lanes input) noexcept
+    {
+        jassert(allpass);
+        auto& state = states[(size_t) block];
+
+        auto yH = (input - state.s1 * (R2 + g) - state.s2) * h;
+
+        auto yB = yH * g + state.s1;
+        state.s1 = yH * g + yB;
+
+        auto yL = yB * g + state.s2;
+        state.s2 = yB * g + yL;
+
+        return yL - yB * R2 + yH;
+    }
+
+private:
+    //==============================================================================
+    void update() noexcept
+    {
+        if (sampleRate <= 0.0)
+            return;
+
+        g = (Sample) std::tan(juce::MathConstants<double>::pi * cutoffFrequency / sampleRate);
+        R2 = (Sample) std::sqrt(2.0);
+        h = (Sample) (1.0 / (1.0 + R2 * g + g * g));
+    }
+
+    struct State
+    {
+        Lanes s1, s2, s3, s4;
+    };
+
+    std::array<State, maxBlocks> states;
+
+    Sample g = 0, R2 = 0, h = 0;
+    Sample cutoffFrequency = 2000;
+    double sampleRate = 0.0;
+    bool allpass = false;
+
+    JUCE_DECLARE_NON_COPYABLE (LinkwitzRileyLanes)
+};
@@ -1,40 +1,125 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-OmniSmartClipAudioProcessorEditor::OmniSmartClipAudioProcessorEditor (OmniSmartClipAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
-}
-
-OmniSmartClipAudioProcessorEditor::~OmniSmartClipAudioProcessorEditor()
-{
-}
-
-//==============================================================================
-void OmniSmartClipAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
-}
-
-void OmniSmartClipAudioProcessorEditor::resized()
-{
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+OmniSmartClipAudioProcessorEditor::OmniSmartClipAudioProcessorEditor (OmniSmartClipAudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p), parameters (p)
+{
+    addAndMakeVisible(parameters);
+    addAndMakeVisible(spectrumView);
+    addAndMakeVisible(curveView);
+    addAndMakeVisible(meterView);
+    
+    juce::StringArray curveIDs { "Drive", "Preserve", "Multiband", "Bands" };
+    
+    for (int split = 1; split < 6; ++split)
+        curveIDs.add("Split" + juce::String(split));
+    
+    for (int band = 1; band <= 6; ++band)
+    {
+        curveIDs.add("Preserve" + juce::String(band));
+        curveIDs.add("Threshold" + juce::String(band));
+        curveIDs.add("Gain" + juce::String(band));
+    }
+    
+    for (auto& id : curveIDs)
+        if (auto* value = audioProcessor.apvts.getRawParameterValue(id))
+            curveParameters.push_back(value);
+    
+    // nothing equals NaN, so the first timerCallback() draws the curve
+    curveValues.resize(curveParameters.size(), std::numeric_limits<float>::quiet_NaN());
+    
+    audioProcessor.getMeters().setActive(true);
+    audioProcessor.getAnalyzer().setActive(true, frameRate);
+    
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (820, 700);
+    
+    lastUpdate = juce::Time::getMillisecondCounterHiRes();
+    timerCallback();
+    startTimerHz(frameRate);
+}
+
+OmniSmartClipAudioProcessorEditor::~OmniSmartClipAudioProcessorEditor()
+{
+    stopTimer();
+    audioProcessor.getMeters().setActive(false);
+    audioProcessor.getAnalyzer().setActive(false);
+}
+
+//==============================================================================
+void OmniSmartClipAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+}
+
+void OmniSmartClipAudioProcessorEditor::resized()
+{
+    auto area = getLocalBounds();
+    parameters.setBounds(area.removeFromLeft(420));
+    spectrumView.setBounds(area.removeFromTop(220));
+    meterView.setBounds(area.removeFromBottom(200));
+    curveView.setBounds(area);
+}
+
+void OmniSmartClipAudioProcessorEditor::timerCallback()
+{
+    auto now = juce::Time::getMillisecondCounterHiRes();
+    meterView.update(audioProcessor.getMeters(), (now - lastUpdate) * 0.001);
+    spectrumView.update(audioProcessor.getAnalyzer());
+    lastUpdate = now;
+    
+    auto changed = false;
+    
+    for (size_t i = 0; i < curveParameters.size(); ++i)
+    {
+        auto value = curveParameters[i]->load(std::memory_order_relaxed);
+        changed = changed || value != curveValues[i];
+        curveValues[i] = value;
+    }
+    
+    if (changed)
+        updateCurve();
+}
+
+void OmniSmartClipAudioProcessorEditor::updateCurve()
+{
+    static const juce::Colour colours[] = { juce::Colours::orange, juce::Colours::skyblue, juce::Colours::lightgreen,
+                                            juce::Colours::violet, juce::Colours::gold, juce::Colours::salmon };
+    
+    auto multiband = audioProcessor.apvts.getRawParameterValue("Multiband")->load() > 0.5f;
+    std::vector<CurveView::Trace> traces;
+    std::vector<float> thresholds;
+    juce::StringArray names;
+    
+    for (int band = 0; band < audioProcessor.getNumCurveBands(); ++band)
+    {
+        auto name = multiband ? "Band " + juce::String(band + 1) : juce::String(band == 0 ? "Low" : "High");
+        traces.push_back({ [this, band] (float x) { return audioProcessor.getBandCurve(band, x); },
+                           colours[band % juce::numElementsInArray(colours)], name });
+        
+        if (audioProcessor.isBandLimited(band))
+        {
+            thresholds.push_back(audioProcessor.getBandThresholdLevel(band));
+            names.add(name);
+        }
+        else
+        {
+            names.add({});
+        }
+    }
+    
+    curveView.setCurve(std::move(traces), std::move(thresholds));
+    spectrumView.setMarkers(audioProcessor.getSplitFrequencies());
+    meterView.setGainReductionNames(names);
+}
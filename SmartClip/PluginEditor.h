@@ -1,33 +1,61 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-/**
-*/
-class OmniSmartClipAudioProcessorEditor  : public juce::AudioProcessorEditor
-{
-public:
-    OmniSmartClipAudioProcessorEditor (OmniSmartClipAudioProcessor&);
-    ~OmniSmartClipAudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-
-private:
-    // This reference is provided as a quick way for your editor to
-    // access the processor object that created it.
-    OmniSmartClipAudioProcessor& audioProcessor;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OmniSmartClipAudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "../Shared/CurveView.h"
+#include "../Shared/MeterView.h"
+#include "../Shared/SpectrumView.h"
+
+//==============================================================================
+/** The parameters, the input and output spectra with the crossover splits
+    marked, the transfer curve of every band and the level and gain
+    reduction meters.
+
+    Nothing here waits on the audio thread. The meters come through the
+    processor's LevelMeters, the spectra from its SpectrumAnalyzer and the
+    curve is drawn from the parameters, all polled by a timer, and the curve
+    is only redrawn when a parameter it depends on has moved.
+*/
+class OmniSmartClipAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                           private juce::Timer
+{
+public:
+    OmniSmartClipAudioProcessorEditor (OmniSmartClipAudioProcessor&);
+    ~OmniSmartClipAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    
+    // rebuilds the curve traces, the split markers and the meter names from the current parameters
+    void updateCurve();
+    
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    OmniSmartClipAudioProcessor& audioProcessor;
+    
+    juce::GenericAudioProcessorEditor parameters;
+    SpectrumView spectrumView;
+    CurveView curveView;
+    MeterView meterView;
+    
+    // everything the curve and the split markers depend on, and the values they were last drawn with
+    std::vector<std::atomic<float>*> curveParameters;
+    std::vector<float> curveValues;
+    
+    static constexpr int frameRate = 30;
+    double lastUpdate = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OmniSmartClipAudioProcessorEditor)
+};
@@ -1,342 +1,1012 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-OmniSmartClipAudioProcessor::OmniSmartClipAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
-#endif
-{
-    drive = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Drive"));
-    
-    preserve = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Preserve"));
-    
-    LP.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
-    HP.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
-}
-
-OmniSmartClipAudioProcessor::~OmniSmartClipAudioProcessor()
-{
-}
-
-//==============================================================================
-const juce::String OmniSmartClipAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool OmniSmartClipAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool OmniSmartClipAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool OmniSmartClipAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double OmniSmartClipAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int OmniSmartClipAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int OmniSmartClipAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void OmniSmartClipAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String OmniSmartClipAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void OmniSmartClipAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void OmniSmartClipAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
-    spec.sampleRate = sampleRate;
-    
-    compressor.prepare(spec);
-    
-    LP.prepare(spec);
-    HP.prepare(spec);
-    
-    inputGain.prepare(spec);
-    compressorInputGain.prepare(spec);
-    compressorOutputGain.prepare(spec);
-    
-    inputGain.setRampDurationSeconds(0.05);
-    compressorInputGain.setRampDurationSeconds(0.05);
-    compressorOutputGain.setRampDurationSeconds(0.05);
-    
-    for (auto& buffer : filterBuffers)
-    {
-        buffer.setSize(spec.numChannels, samplesPerBlock);
-    }
-}
-
-void OmniSmartClipAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool OmniSmartClipAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void OmniSmartClipAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    // CUSTOM CODE
-
-        // gets values from the parameters
-        float preserveParam = preserve->get();
-        float driveParam = drive->get();
-
-        // sets the compressor parameters
-        compressor.setRelease(30);
-        compressor.setAttack(0);
-        compressor.setRatio(100);
-        compressor.setThreshold(remap(preserveParam, 0, 127, 0.00, -4.00));
-
-        // sets all gain settings
-        inputGain.setGainDecibels(driveParam);
-        compressorInputGain.setGainDecibels(remap(preserveParam, 0, 127, -20.0, 0));
-        compressorOutputGain.setGainDecibels(remap(preserveParam, 0, 127, 19.5, 0));
-
-        applyGain(buffer, inputGain);
-
-        // creates audio block and context of input signal
-        auto block = juce::dsp::AudioBlock<float>(buffer);
-        auto context = juce::dsp::ProcessContextReplacing<float>(block);
-
-        // prepares the array of buffers for the filters
-        for (auto& fb : filterBuffers)
-        {
-            fb = buffer;
-        }
-
-        // sets filter cutoff
-        auto cutoff = 140;
-        LP.setCutoffFrequency(cutoff);
-        HP.setCutoffFrequency(cutoff);
-
-        // sets up blocks and context for each filter
-        auto fb0Block = juce::dsp::AudioBlock<float>(filterBuffers[0]);
-        auto fb1Block = juce::dsp::AudioBlock<float>(filterBuffers[1]);
-
-        auto fb0Ctx = juce::dsp::ProcessContextReplacing<float>(fb0Block);
-        auto fb1Ctx = juce::dsp::ProcessContextReplacing<float>(fb1Block);
-
-        // processes each context for high and low pass
-        LP.process(fb0Ctx);
-        HP.process(fb1Ctx);
-
-        // applies low band compressor input gain
-        applyGain(filterBuffers[0], compressorInputGain);
-
-        /* fb0Block = juce::dsp::AudioBlock<float>(filterBuffers[0]);
-        fb1Block = juce::dsp::AudioBlock<float>(filterBuffers[1]);
-
-        auto fb0Ctx = juce::dsp::ProcessContextReplacing<float>(fb0Block);
-        auto fb1Ctx = juce::dsp::ProcessContextReplacing<float>(fb1Block); */
-
-        // compresses the low band
-        compressor.process(fb0Ctx);
-
-        // applies low band output gain
-        applyGain(filterBuffers[0], compressorOutputGain);
-
-        // sets variables for sample number and channel numbers
-        auto numSamples = buffer.getNumSamples();
-        auto numChannels = buffer.getNumChannels();
-
-        buffer.clear();
-
-        // sums the two filters back together
-        auto addFilterBand = [nc = numChannels, ns = numSamples](auto& inputBuffer, const auto& source)
-        {
-            for (auto i = 0; i < nc; ++i)
-            {
-                inputBuffer.addFrom(i, 0, source, i, 0, ns);
-            }
-        };
-
-        addFilterBand(buffer, filterBuffers[0]);
-        addFilterBand(buffer, filterBuffers[1]);
-
-
-        // anologue cliper (3rd power)
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
-        {
-            auto* channelData = buffer.getWritePointer(channel);
-
-            for (int sample = 0; sample < numSamples; ++sample)
-            {
-                // creates temporary calculation variable
-                double tmp = 0.0f;
-                tmp = channelData[sample];
-
-                float thresh = 3.0f / 2.0f;
-
-                // the function itself
-                if (tmp > thresh) {
-                    tmp = 1;
-                }
-                else if (tmp < -thresh) {
-                    tmp = -1;
-                }
-                else if (tmp >= -thresh && tmp <= thresh) {
-                    tmp = tmp - (4.0 / 27.0) * pow(tmp, 3);
-                }
-                else {
-                    tmp = 0;
-                }
-
-                buffer.setSample(channel, sample, tmp);
-
-            }
-
-        }
-}
-
-//==============================================================================
-bool OmniSmartClipAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* OmniSmartClipAudioProcessor::createEditor()
-{
-    //return new OmniSmartClipAudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
-}
-
-//==============================================================================
-void OmniSmartClipAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-}
-
-void OmniSmartClipAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-}
-
-float OmniSmartClipAudioProcessor::remap(float value, float start1, float end1, float start2, float end2) {
-    float outgoing = start2 + (end2 - start2) * ((value - start1) / (end1 - start1));
-    return outgoing;
-}
-
-float OmniSmartClipAudioProcessor::analogClip(float input) {
-    if (input > 1)
-        return 1;
-    if (input < -1)
-        return -1;
-    return (((3 * input) - (input * input * input)) / 2);
-}
-
-juce::AudioProcessorValueTreeState::ParameterLayout OmniSmartClipAudioProcessor::createParameterLayout() {
-    APVTS::ParameterLayout layout;
-    
-    using namespace juce;
-    
-    layout.add(std::make_unique<AudioParameterFloat>("Drive",
-                                                    "Drive",
-                                                    NormalisableRange<float>(0, 16, 0.01f, 1),
-                                                    0));
-    
-    layout.add(std::make_unique<AudioParameterFloat>("Preserve",
-                                                     "Preserve",
-                                                     NormalisableRange<float>(0, 127, 1, 1),
-                                                     0));
-    
-    return layout;
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new OmniSmartClipAudioProcessor();
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+OmniSmartClipAudioProcessor::OmniSmartClipAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       )
+#endif
+{
+    drive = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Drive"));
+    
+    preserve = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Preserve"));
+    
+    link = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("Link"));
+    
+    multiband = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("Multiband"));
+    
+    oversampling = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("Oversampling"));
+    
+    linearPhase = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("LinearPhase"));
+    
+    antialiasing = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("Antialiasing"));
+    
+    lookahead = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Lookahead"));
+    
+    bandCount = dynamic_cast<juce::AudioParameterInt*>(apvts.getParameter("Bands"));
+    
+    for (int split = 0; split < maxBands - 1; ++split)
+        splits[(size_t) split] = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Split" + juce::String(split + 1)));
+    
+    for (int band = 0; band < maxBands; ++band)
+    {
+        auto number = juce::String(band + 1);
+        bandPreserve[(size_t) band] = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Preserve" + number));
+        bandThreshold[(size_t) band] = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Threshold" + number));
+        bandGain[(size_t) band] = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("Gain" + number));
+    }
+    
+    // processSample() with two outputs gives the low and high band together
+    forEachChain([] (auto& chain)
+    {
+        for (auto& crossover : chain.crossovers)
+            crossover.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        
+        for (auto& bandAllpasses : chain.allpasses)
+            for (auto& allpass : bandAllpasses)
+                allpass.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+    });
+    
+    for (auto* parameter : getParameters())
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter))
+            apvts.addParameterListener(withID->paramID, this);
+}
+
+OmniSmartClipAudioProcessor::~OmniSmartClipAudioProcessor()
+{
+    for (auto* parameter : getParameters())
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter))
+            apvts.removeParameterListener(withID->paramID, this);
+}
+
+//==============================================================================
+const juce::String OmniSmartClipAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool OmniSmartClipAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool OmniSmartClipAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool OmniSmartClipAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double OmniSmartClipAudioProcessor::getTailLengthSeconds() const
+{
+    // the oversampling filters ring on for about their latency, and the
+    // lookahead delay still holds its last few ms when the input stops, so
+    // the whole reported latency covers both
+    return getSampleRate() > 0.0 ? latencyReporter.get() / getSampleRate() : 0.0;
+}
+
+int OmniSmartClipAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int OmniSmartClipAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void OmniSmartClipAudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const juce::String OmniSmartClipAudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void OmniSmartClipAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+}
+
+//==============================================================================
+void OmniSmartClipAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = samplesPerBlock;
+    spec.numChannels = getTotalNumOutputChannels();
+    spec.sampleRate = sampleRate;
+    
+    // the filters and limiters only hold state for this many channels
+    preparedChannels = (int) spec.numChannels;
+    
+    kernelIsa = KernelDispatch::select();
+    analyzer.prepare(sampleRate);
+    
+    forEachChain([&] (auto& chain)
+    {
+        for (auto& crossover : chain.crossovers)
+            crossover.prepare(spec);
+        
+        for (auto& bandAllpasses : chain.allpasses)
+            for (auto& allpass : bandAllpasses)
+                allpass.prepare(spec);
+        
+        for (auto& limiter : chain.limiters)
+        {
+            limiter.prepare(sampleRate, preparedChannels, (int) std::ceil(maxLookaheadMs * 0.001 * sampleRate));
+            
+            // fixed settings, these only need redoing when the sample rate changes
+            limiter.setRelease(30);
+            limiter.setRatio(compressorRatio);
+        }
+        
+        // every tier is built here so they can be switched between on the audio thread.
+        // It only ever gets one sub-block at a time, so its buffers are sized for that
+        chain.clipOversampler.prepare(preparedChannels, ProcessorHelpers::subBlockSize, *tableStore);
+    });
+    
+    for (auto& band : bands)
+    {
+        band.threshold.reset(sampleRate, 0.05);
+        band.inputGain.reset(sampleRate, 0.05);
+        band.outputGain.reset(sampleRate, 0.05);
+    }
+    
+    inputGain.reset(sampleRate, 0.05);
+    
+    updateLatency();
+    latencyReporter.reportNow(latencyReporter.get());
+    antiderivativeClipper.reset();
+    silenceGate.reset();
+    
+    // one worker for every group of channels past the first, which the audio thread does itself,
+    // from the pool every instance shares (see ChannelWorkerPool.h). An offline render gets its
+    // parallelism from rendering several files or chunks at once, so it runs them all here
+    if (! isNonRealtime())
+    {
+        auto numGroups = (preparedChannels + channelsPerGroup - 1) / channelsPerGroup;
+        workers->reserve(numGroups - 1, sampleRate, samplesPerBlock);
+    }
+    
+    parametersChanged = true;
+}
+
+void OmniSmartClipAudioProcessor::releaseResources()
+{
+    // When playback stops, you can use this as an opportunity to free up any
+    // spare memory, etc.
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool OmniSmartClipAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // any discrete, surround or ambisonic layout up to maxChannels, every
+    // channel is processed the same way
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || layouts.getMainOutputChannelSet().size() > maxChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void OmniSmartClipAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBuffer(buffer);
+}
+
+void OmniSmartClipAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBuffer(buffer);
+}
+
+template <typename Sample>
+void OmniSmartClipAudioProcessor::processBuffer (juce::AudioBuffer<Sample>& buffer) noexcept
+{
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    
+    // CUSTOM CODE
+
+        // nothing in here may allocate, lock or make a system call. All state
+        // is sized in prepareToPlay and the sub-block loop copes with any block
+        // size, so blocks larger than samplesPerBlock are fine.
+
+        // channels the dsp wasn't prepared for have no filter or limiter
+        // state, so they are silenced rather than processed
+        jassert(totalNumInputChannels <= juce::jmin(preparedChannels, maxChannels));
+        auto numChannels = juce::jmin(totalNumInputChannels, preparedChannels, maxChannels);
+
+        for (auto i = numChannels; i < totalNumInputChannels; ++i)
+            buffer.clear(i, 0, buffer.getNumSamples());
+
+        stageTimer.beginBlock();
+        
+        // the editor only wants levels while it is open
+        auto metering = meters.isActive();
+        
+        if (metering)
+            meters.measureInput(buffer, numChannels);
+        
+        // the analyzer only takes a mono copy, its FFTs run on its own thread
+        auto analysing = analyzer.isActive();
+        
+        if (analysing)
+            analyzer.pushInput(buffer, numChannels);
+
+        if constexpr (StageTimer::isEnabled())
+            for (int channel = 0; channel < numChannels; ++channel)
+                stageTimer.addDenormals(StageTimer::countDenormals(buffer.getReadPointer(channel), buffer.getNumSamples()));
+
+        // only recalculates the derived settings when a parameter has moved
+        if (parametersChanged.exchange(false))
+        {
+            StageTimer::Scope timing (stageTimer, parametersStage);
+            updateParameters();
+        }
+
+        // sets variables for sample number and channel numbers
+        auto numSamples = buffer.getNumSamples();
+        auto linked = link->get();
+        auto& chain = getChain<Sample>();
+
+        // an instance whose input has been silent long enough sleeps through
+        // the whole chain, and wakes on the first block with signal in it
+        auto asleep = silenceGate.skipBlock(SilenceGate::isSilent(buffer, numChannels), numSamples);
+
+        if (asleep)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                buffer.clear(channel, 0, numSamples);
+
+            // the ramps still move on, so waking finds them where they would have been
+            skipParameterRamps(numSamples);
+        }
+        else
+        {
+            // The block is worked through a sub-block at a time, with the parameters
+            // read again before each. Automation lands within subBlockSize samples of
+            // where the host put it, whatever size of block the host sends, and the
+            // gain ramps retarget from there. Every group runs the same sub-block
+            // before the oversampled clip gets it, so none of it leaves cache between.
+            ProcessorHelpers::forEachSubBlock(numSamples, [&] (int start, int length)
+            {
+                if (parametersChanged.exchange(false))
+                {
+                    StageTimer::Scope timing (stageTimer, parametersStage);
+                    updateParameters();
+                }
+
+                auto subBuffer = ProcessorHelpers::subBuffer(buffer, numChannels, start, length);
+                processSubBlock(subBuffer, numChannels, linked);
+
+                // every group ran through its own copy of the ramps, so the originals catch up here
+                skipParameterRamps(length);
+            });
+        }
+
+        // what the filters flush out of their state counts as denormals too
+        if (! asleep)
+        {
+            for (int split = 0; split < numBands - 1; ++split)
+            {
+                stageTimer.addDenormals(chain.crossovers[(size_t) split].snapToZero());
+
+                for (int band = 0; band < split; ++band)
+                    stageTimer.addDenormals(chain.allpasses[(size_t) band][(size_t) split].snapToZero());
+            }
+        }
+
+        // once the silence has gone all the way through and everything has died
+        // away, the state is cleared so that waking up starts from nothing
+        if (silenceGate.isWaitingToSleep() && hasDecayed(buffer, numChannels))
+        {
+            resetChain(chain);
+            antiderivativeClipper.reset();
+            silenceGate.sleep();
+        }
+
+        // the limiters keep their deepest gain reduction until it is taken, so it is
+        // taken once and handed to whoever is listening
+        if (metering || StageTimer::isEnabled())
+        {
+            for (int band = 0; band < numBands; ++band)
+            {
+                if (bands[(size_t) band].limited)
+                {
+                    auto gainReduction = chain.limiters[(size_t) band].takeGainReduction(numChannels);
+                    stageTimer.setGainReduction(band, gainReduction);
+                    meters.setGainReduction(band, gainReduction);
+                }
+            }
+        }
+
+        stageTimer.endBlock(numSamples, numChannels);
+        
+        if (metering)
+        {
+            meters.measureOutput(buffer, numChannels);
+            meters.publish();
+        }
+        
+        if (analysing)
+            analyzer.pushOutput(buffer, numChannels);
+}
+
+template <typename Sample>
+void OmniSmartClipAudioProcessor::processSubBlock (juce::AudioBuffer<Sample>& buffer, int numChannels, bool linked) noexcept
+{
+    auto& chain = getChain<Sample>();
+    constexpr auto laneWidth = Chain<Sample>::Filter::laneWidth;
+
+    // the limiters are shared by every group, so their thresholds follow
+    // their ramps here, a sub-block at a time
+    for (int band = 0; band < numBands; ++band)
+        if (bands[(size_t) band].limited)
+            chain.limiters[(size_t) band].setThreshold(bands[(size_t) band].threshold.getCurrentValue());
+
+    // unlinked channels are independent, so past channelsPerGroup they are
+    // split into groups that run in parallel on the worker pool. Linked
+    // detection needs every channel at once so it always runs here, and so
+    // does an offline render.
+    auto numGroups = linked || isNonRealtime() ? 1 : juce::jmin(workers->getNumWorkers() + 1,
+                                                                (numChannels + channelsPerGroup - 1) / channelsPerGroup);
+
+    if (numGroups > 1)
+    {
+        // rounded up to whole lane blocks, which can leave fewer groups
+        auto channelsPerThread = (numChannels + numGroups - 1) / numGroups;
+        channelsPerThread = (channelsPerThread + laneWidth - 1) / laneWidth * laneWidth;
+        numGroups = (numChannels + channelsPerThread - 1) / channelsPerThread;
+
+        auto processGroup = [&] (int group)
+        {
+            auto firstChannel = group * channelsPerThread;
+            processChannels(buffer, firstChannel, juce::jmin(channelsPerThread, numChannels - firstChannel),
+                            false, group == 0);
+        };
+
+        workers->run(numGroups, processGroup);
+    }
+    else
+    {
+        processChannels(buffer, 0, numChannels, linked, true);
+    }
+
+    // oversampled clipping needs every channel at once, so it runs here
+    // after the groups have summed their bands
+    if (chain.clipOversampler.getFactor() > 1)
+    {
+        StageTimer::Scope timing (stageTimer, clipStage);
+
+        chain.clipOversampler.process(juce::dsp::AudioBlock<Sample>(buffer).getSubsetChannelBlock(0, (size_t) numChannels),
+                                      [this] (int channel, Sample* data, int n) { clipChannel(channel, data, n); });
+    }
+}
+
+void OmniSmartClipAudioProcessor::skipParameterRamps (int numSamples) noexcept
+{
+    inputGain.skip(numSamples);
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        bands[(size_t) band].threshold.skip(numSamples);
+        bands[(size_t) band].inputGain.skip(numSamples);
+        bands[(size_t) band].outputGain.skip(numSamples);
+    }
+}
+
+template <typename Sample>
+bool OmniSmartClipAudioProcessor::hasDecayed (const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept
+{
+    auto& chain = getChain<Sample>();
+    constexpr auto threshold = (Sample) SilenceGate::silenceThreshold;
+    
+    if (inputGain.isRamping())
+        return false;
+    
+    for (int band = 0; band < numBands; ++band)
+    {
+        auto& settings = bands[(size_t) band];
+        
+        if (settings.threshold.isRamping() || settings.inputGain.isRamping() || settings.outputGain.isRamping()
+             || (settings.limited && chain.limiters[(size_t) band].getEnvelopeMagnitude() >= (float) threshold))
+            return false;
+    }
+    
+    for (int split = 0; split < numBands - 1; ++split)
+    {
+        if (chain.crossovers[(size_t) split].getStateMagnitude() >= threshold)
+            return false;
+        
+        for (int band = 0; band < split; ++band)
+            if (chain.allpasses[(size_t) band][(size_t) split].getStateMagnitude() >= threshold)
+                return false;
+    }
+    
+    // the oversampling filters can't be looked into, but they have had the tail
+    // length to empty out and would show up here if they still held anything
+    return SilenceGate::isSilent(buffer, numChannels);
+}
+
+template <typename ChainType>
+void OmniSmartClipAudioProcessor::resetChain (ChainType& chain) noexcept
+{
+    for (auto& crossover : chain.crossovers)
+        crossover.reset();
+    
+    for (auto& bandAllpasses : chain.allpasses)
+        for (auto& allpass : bandAllpasses)
+            allpass.reset();
+    
+    for (auto& limiter : chain.limiters)
+        limiter.reset();
+    
+    chain.clipOversampler.reset();
+}
+
+template <typename Sample>
+void OmniSmartClipAudioProcessor::processChannels (juce::AudioBuffer<Sample>& buffer, int firstChannel, int numChannels,
+                                                   bool linked, bool recordTimings) noexcept
+{
+    using Filter = typename Chain<Sample>::Filter;
+    using Lanes = typename Chain<Sample>::Lanes;
+
+    auto& chain = getChain<Sample>();
+    auto numSamples = buffer.getNumSamples();
+    auto lastChannel = firstChannel + numChannels;
+    auto numSplits = numBands - 1;
+
+    // groups start on a lane block, see processBlock
+    jassert(firstChannel % Filter::laneWidth == 0);
+
+    // copies of the ramps, so groups on different threads can all walk through them
+    auto inGain = inputGain;
+    std::array<ParameterRamp, maxBands> bandInGains, bandOutGains;
+    std::array<float, tileSize> inputGainRamp;
+    std::array<std::array<float, tileSize>, maxBands> bandInputGainRamps, bandOutputGainRamps;
+
+    // when nothing is ramping the gains are filled in once for the whole sub-block
+    auto gainsAreSteady = ! inGain.isRamping();
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        bandInGains[(size_t) band] = bands[(size_t) band].inputGain;
+        bandOutGains[(size_t) band] = bands[(size_t) band].outputGain;
+        gainsAreSteady = gainsAreSteady && ! (bandInGains[(size_t) band].isRamping() || bandOutGains[(size_t) band].isRamping());
+    }
+
+    // the ramps write a tile of gains at a time, see ParameterRamp.h
+    auto fillGains = [&] (int tileLength)
+    {
+        inGain.fillGain(kernelIsa, inputGainRamp.data(), tileLength);
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            bandInGains[(size_t) band].fillGain(kernelIsa, bandInputGainRamps[(size_t) band].data(), tileLength);
+            bandOutGains[(size_t) band].fillGain(kernelIsa, bandOutputGainRamps[(size_t) band].data(), tileLength);
+        }
+    };
+
+    if (gainsAreSteady)
+        fillGains(tileSize);
+
+    // runs the whole chain one tile at a time, so every stage works on data
+    // that is still in cache: gain -> crossover tree -> band limiters -> sum -> clip
+    for (int tileStart = 0; tileStart < numSamples; tileStart += tileSize)
+    {
+        auto tileLength = juce::jmin(tileSize, numSamples - tileStart);
+        auto gainStart = StageTimer::now();
+
+        // the gain ramps are shared by every channel
+        if (! gainsAreSteady)
+            fillGains(tileLength);
+
+        auto crossoverStart = StageTimer::now();
+
+        // splits every channel into all its bands at once, each band going
+        // into its row of the arena with its input gain applied. A lane block
+        // of channels goes through the tree together, unused lanes stay silent.
+        for (int blockStart = firstChannel; blockStart < lastChannel; blockStart += Filter::laneWidth)
+        {
+            auto block = Filter::blockFor(blockStart);
+            auto numLanes = juce::jmin(Filter::laneWidth, lastChannel - blockStart);
+
+            // the tile, interleaved so each sample's lanes can be loaded at once
+            alignas (sizeof (Lanes)) std::array<Sample, tileSize * Filter::laneWidth> interleaved {};
+            alignas (sizeof (Lanes)) std::array<Sample, Filter::laneWidth> lanes;
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                auto* channelData = buffer.getReadPointer(blockStart + lane, tileStart);
+
+                for (int i = 0; i < tileLength; ++i)
+                    interleaved[(size_t) (i * Filter::laneWidth + lane)] = channelData[i];
+            }
+
+            for (int i = 0; i < tileLength; ++i)
+            {
+                auto rest = Lanes::fromRawArray(interleaved.data() + i * Filter::laneWidth) * inputGainRamp[(size_t) i];
+
+                for (int split = 0; split <= numSplits; ++split)
+                {
+                    Lanes low;
+
+                    if (split < numSplits)
+                    {
+                        Lanes high;
+                        chain.crossovers[(size_t) split].processSample(block, rest, low, high);
+
+                        for (int above = split + 1; above < numSplits; ++above)
+                            low = chain.allpasses[(size_t) split][(size_t) above].processSample(block, low);
+
+                        rest = high;
+                    }
+                    else
+                    {
+                        low = rest;
+                    }
+
+                    (low * bandInputGainRamps[(size_t) split][(size_t) i]).copyToRawArray(lanes.data());
+
+                    for (int lane = 0; lane < numLanes; ++lane)
+                        chain.getBandTile(split, blockStart + lane)[i] = lanes[(size_t) lane];
+                }
+            }
+        }
+
+        auto limiterStart = StageTimer::now();
+
+        // limits every band on its own, then applies its output gain
+        for (int bandIndex = 0; bandIndex < numBands; ++bandIndex)
+        {
+            auto& band = bands[(size_t) bandIndex];
+            auto& limiter = chain.limiters[(size_t) bandIndex];
+            auto& outputGainRamp = bandOutputGainRamps[(size_t) bandIndex];
+
+            if (! band.limited)
+            {
+                // still delayed by the lookahead, to stay lined up with the limited bands
+                for (int channel = firstChannel; channel < lastChannel; ++channel)
+                {
+                    auto* tile = chain.getBandTile(bandIndex, channel);
+                    limiter.delay(channel, tile, tileLength);
+
+                    KernelDispatch::multiply(kernelIsa, tile, outputGainRamp.data(), tileLength);
+                }
+            }
+            else if (linked)
+            {
+                // linked runs as one group, so firstChannel is 0 here
+                jassert(firstChannel == 0);
+
+                std::array<Sample*, maxChannels> rows;
+
+                for (int channel = 0; channel < lastChannel; ++channel)
+                    rows[(size_t) channel] = chain.getBandTile(bandIndex, channel);
+
+                limiter.processLinked(rows.data(), lastChannel, outputGainRamp.data(), tileLength);
+            }
+            else
+            {
+                for (int channel = firstChannel; channel < lastChannel; ++channel)
+                    limiter.process(channel, chain.getBandTile(bandIndex, channel), outputGainRamp.data(), tileLength);
+            }
+        }
+
+        auto sumStart = StageTimer::now();
+
+        // sums the bands back together
+        for (int channel = firstChannel; channel < lastChannel; ++channel)
+        {
+            auto* channelData = buffer.getWritePointer(channel, tileStart);
+
+            juce::FloatVectorOperations::copy(channelData, chain.getBandTile(0, channel), tileLength);
+
+            for (int band = 1; band < numBands; ++band)
+                KernelDispatch::add(kernelIsa, channelData, chain.getBandTile(band, channel), tileLength);
+        }
+
+        auto clipStart = StageTimer::now();
+
+        // runs the anologue cliper (3rd power) over the summed tile while it is still
+        // in cache, unless it is oversampled, which processBlock does afterwards
+        if (chain.clipOversampler.getFactor() == 1)
+            for (int channel = firstChannel; channel < lastChannel; ++channel)
+                clipChannel(channel, buffer.getWritePointer(channel, tileStart), tileLength);
+
+        // only one thread may write the timings, see processBlock
+        if (recordTimings)
+        {
+            auto clipEnd = StageTimer::now();
+
+            stageTimer.add(gainStage, crossoverStart - gainStart);
+            stageTimer.add(crossoverStage, limiterStart - crossoverStart);
+            stageTimer.add(limiterStage, sumStart - limiterStart);
+            stageTimer.add(sumStage, clipStart - sumStart);
+            stageTimer.add(clipStage, clipEnd - clipStart);
+        }
+    }
+}
+
+//==============================================================================
+bool OmniSmartClipAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* OmniSmartClipAudioProcessor::createEditor()
+{
+    return new OmniSmartClipAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void OmniSmartClipAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    // You should use this method to store your parameters in the memory block.
+    // You could do that either as raw data, or use the XML or ValueTree classes
+    // as intermediaries to make it easy to save and load complex data.
+}
+
+void OmniSmartClipAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // You should use this method to restore your parameters from this memory block,
+    // whose contents will have been created by the getStateInformation() call.
+}
+
+void OmniSmartClipAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // can be called from any thread, the audio thread picks the change up on its next block
+    parametersChanged = true;
+}
+
+void OmniSmartClipAudioProcessor::updateParameters()
+{
+    // gets values from the parameters
+    float driveParam = drive->get();
+    auto multibandParam = multiband->get();
+    auto numBandsParam = multibandParam ? bandCount->get() : 2;
+    
+    // bands that weren't running have stale filter and limiter state
+    if (multibandParam != multibandActive || numBandsParam != numBands)
+    {
+        forEachChain([] (auto& chain)
+        {
+            for (auto& crossover : chain.crossovers)
+                crossover.reset();
+            
+            for (auto& bandAllpasses : chain.allpasses)
+                for (auto& allpass : bandAllpasses)
+                    allpass.reset();
+            
+            for (auto& limiter : chain.limiters)
+                limiter.reset();
+        });
+        
+        multibandActive = multibandParam;
+        numBands = numBandsParam;
+    }
+    
+    inputGain.setTarget(driveParam);
+    
+    // the same mapping from Preserve for every limited band, plus the band's own trims
+    auto setBand = [this] (int bandIndex, float preserveParam, float thresholdOffset, float gainOffset)
+    {
+        auto& band = bands[(size_t) bandIndex];
+        auto settings = mapBandSettings(preserveParam, thresholdOffset, gainOffset);
+        
+        // the limiter threshold follows its ramp in processSubBlock
+        band.threshold.setTarget(settings.threshold);
+        band.inputGain.setTarget(settings.inputGain);
+        band.outputGain.setTarget(settings.outputGain);
+        band.limited = true;
+    };
+    
+    std::array<float, maxBands - 1> frequencies;
+    
+    if (multibandParam)
+    {
+        for (int band = 0; band < numBands; ++band)
+            setBand(band, bandPreserve[(size_t) band]->get(),
+                    bandThreshold[(size_t) band]->get(), bandGain[(size_t) band]->get());
+        
+        for (int split = 0; split < numBands - 1; ++split)
+            frequencies[(size_t) split] = splits[(size_t) split]->get();
+        
+        // the splits can be automated past each other, the tree needs them in order
+        std::sort(frequencies.begin(), frequencies.begin() + numBands - 1);
+    }
+    else
+    {
+        // the low band is limited according to Preserve, the high band is left alone
+        setBand(0, preserve->get(), 0.0f, 0.0f);
+        
+        bands[1].inputGain.setTarget(0.0f);
+        bands[1].outputGain.setTarget(0.0f);
+        bands[1].limited = false;
+        
+        frequencies[0] = normalSplitFrequency;
+    }
+    
+    setSplitFrequencies(frequencies.data(), numBands - 1);
+    
+    auto factor = floatChain.clipOversampler.getFactor();
+    updateLatency();
+    
+    // the previous inputs are only any use at the same order and rate
+    auto antialiasingParam = antialiasing->getIndex();
+    
+    if (antialiasingParam != antialiasingOrder || factor != floatChain.clipOversampler.getFactor())
+    {
+        antiderivativeClipper.reset();
+        antialiasingOrder = antialiasingParam;
+    }
+}
+
+template <typename Sample>
+void OmniSmartClipAudioProcessor::clipChannel(int channel, Sample* data, int numSamples) noexcept
+{
+    if (antialiasingOrder == 0)
+        ClipKernels::clip(kernelIsa, ClipKernels::cubicCurve, data, numSamples);
+    else
+        antiderivativeClipper.process(ClipKernels::cubicCurve, channel, data, numSamples, antialiasingOrder);
+}
+
+OmniSmartClipAudioProcessor::BandSettings OmniSmartClipAudioProcessor::mapBandSettings (float preserveParam, float thresholdOffset,
+                                                                                      float gainOffset) noexcept
+{
+    BandSettings settings;
+    settings.threshold = ProcessorHelpers::remap(preserveParam, 0, 127, 0.00, -4.00) + thresholdOffset;
+    settings.inputGain = ProcessorHelpers::remap(preserveParam, 0, 127, -20.0, 0);
+    settings.outputGain = ProcessorHelpers::remap(preserveParam, 0, 127, 19.5, 0) + gainOffset;
+    settings.limited = true;
+    return settings;
+}
+
+OmniSmartClipAudioProcessor::BandSettings OmniSmartClipAudioProcessor::getBandSettings (int band) const
+{
+    if (multiband->get())
+        return mapBandSettings(bandPreserve[(size_t) band]->get(), bandThreshold[(size_t) band]->get(), bandGain[(size_t) band]->get());
+    
+    // the high band of the normal mode is left alone
+    return band == 0 ? mapBandSettings(preserve->get(), 0.0f, 0.0f) : BandSettings();
+}
+
+int OmniSmartClipAudioProcessor::getNumCurveBands() const
+{
+    return multiband->get() ? bandCount->get() : 2;
+}
+
+bool OmniSmartClipAudioProcessor::isBandLimited (int band) const
+{
+    return getBandSettings(band).limited;
+}
+
+float OmniSmartClipAudioProcessor::getBandCurve (int band, float input) const
+{
+    auto settings = getBandSettings(band);
+    auto x = input * juce::Decibels::decibelsToGain(drive->get());
+    
+    if (settings.limited)
+    {
+        // above the threshold a steady level comes out at threshold * (level / threshold) ^ (1 / ratio)
+        auto threshold = juce::Decibels::decibelsToGain(settings.threshold);
+        auto level = std::abs(x * juce::Decibels::decibelsToGain(settings.inputGain));
+        
+        if (level > threshold)
+            level = threshold * std::pow(level / threshold, 1.0f / compressorRatio);
+        
+        x = std::copysign(level * juce::Decibels::decibelsToGain(settings.outputGain), x);
+    }
+    
+    return (float) ClipKernels::cubicCurve.f(x);
+}
+
+std::vector<float> OmniSmartClipAudioProcessor::getSplitFrequencies() const
+{
+    if (! multiband->get())
+        return { normalSplitFrequency };
+    
+    std::vector<float> frequencies;
+    
+    for (int split = 0; split < bandCount->get() - 1; ++split)
+        frequencies.push_back(splits[(size_t) split]->get());
+    
+    std::sort(frequencies.begin(), frequencies.end());
+    return frequencies;
+}
+
+float OmniSmartClipAudioProcessor::getBandThresholdLevel (int band) const
+{
+    auto settings = getBandSettings(band);
+    
+    if (! settings.limited)
+        return 0.0f;
+    
+    return juce::Decibels::decibelsToGain(settings.threshold - settings.inputGain - drive->get());
+}
+
+void OmniSmartClipAudioProcessor::updateLatency()
+{
+    // every band is delayed by the same lookahead, limited or not. Lookahead
+    // is automatable, so like the tier this runs on the audio thread and the
+    // host hears about it through latencyReporter
+    auto lookaheadSamples = juce::roundToInt(lookahead->get() * 0.001 * getSampleRate());
+    
+    forEachChain([&] (auto& chain)
+    {
+        chain.clipOversampler.select(oversampling->getIndex(), linearPhase->get());
+        
+        for (auto& limiter : chain.limiters)
+            limiter.setLookahead(lookaheadSamples);
+    });
+    
+    // called on the audio thread, so the host only hears about it from the message thread
+    auto latency = [] (auto& chain) { return chain.clipOversampler.getLatencyInSamples() + chain.limiters[0].getLookahead(); };
+    latencyReporter.report(isUsingDoublePrecision() ? latency(doubleChain) : latency(floatChain));
+    
+    // the oversampling filters hold about twice their latency, and the rest
+    // of the chain is checked directly before going to sleep
+    silenceGate.setTailSamples(2 * latencyReporter.get() + tileSize);
+}
+
+void OmniSmartClipAudioProcessor::setSplitFrequencies(const float* frequencies, int numSplits)
+{
+    // keeps every split clear of nyquist at low sample rates
+    auto highest = (float) getSampleRate() * 0.45f;
+    
+    for (int split = 0; split < numSplits; ++split)
+    {
+        auto frequency = highest > 0.0f ? juce::jmin(frequencies[split], highest) : frequencies[split];
+        forEachChain([&] (auto& chain)
+        {
+            chain.crossovers[(size_t) split].setCutoffFrequency(frequency);
+            
+            // every band below this split needs its allpass
+            for (int band = 0; band < split; ++band)
+                chain.allpasses[(size_t) band][(size_t) split].setCutoffFrequency(frequency);
+        });
+    }
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout OmniSmartClipAudioProcessor::createParameterLayout() {
+    APVTS::ParameterLayout layout;
+    
+    using namespace juce;
+    
+    layout.add(std::make_unique<AudioParameterFloat>("Drive",
+                                                    "Drive",
+                                                    NormalisableRange<float>(0, 16, 0.01f, 1),
+                                                    0));
+    
+    layout.add(std::make_unique<AudioParameterFloat>("Preserve",
+                                                     "Preserve",
+                                                     NormalisableRange<float>(0, 127, 1, 1),
+                                                     0));
+    
+    // shares each limited band's gain reduction across all channels when on
+    layout.add(std::make_unique<AudioParameterBool>("Link",
+                                                    "Link",
+                                                    false));
+    
+    // runs the clipper at a higher rate so it doesn't alias, at the cost of some latency
+    layout.add(std::make_unique<AudioParameterChoice>("Oversampling",
+                                                      "Oversampling",
+                                                      ClipOversampler<float>::getTierNames(),
+                                                      0));
+    
+    layout.add(std::make_unique<AudioParameterBool>("LinearPhase",
+                                                    "Linear Phase",
+                                                    false));
+    
+    // cuts aliasing without oversampling, by clipping the average over each sample step
+    layout.add(std::make_unique<AudioParameterChoice>("Antialiasing",
+                                                      "Antialiasing",
+                                                      AntiderivativeClipper<maxChannels>::getOrderNames(),
+                                                      0));
+    
+    // delays the audio so the limiters can react before a peak, in ms
+    layout.add(std::make_unique<AudioParameterFloat>("Lookahead",
+                                                     "Lookahead",
+                                                     NormalisableRange<float>(0, maxLookaheadMs, 0.01f, 1),
+                                                     0));
+    
+    // splits into Bands bands, each with its own limiter, instead of the fixed 140 Hz split
+    layout.add(std::make_unique<AudioParameterBool>("Multiband",
+                                                    "Multiband",
+                                                    false));
+    
+    layout.add(std::make_unique<AudioParameterInt>("Bands",
+                                                   "Bands",
+                                                   2, maxBands, 3));
+    
+    const float defaultSplits[] = { 140, 600, 2000, 5000, 10000 };
+    
+    for (int split = 0; split < maxBands - 1; ++split)
+    {
+        auto number = String(split + 1);
+        layout.add(std::make_unique<AudioParameterFloat>("Split" + number,
+                                                         "Split " + number,
+                                                         NormalisableRange<float>(20, 20000, 1, 0.25f),
+                                                         defaultSplits[split]));
+    }
+    
+    for (int band = 0; band < maxBands; ++band)
+    {
+        auto number = String(band + 1);
+        
+        layout.add(std::make_unique<AudioParameterFloat>("Preserve" + number,
+                                                         "Band " + number + " Preserve",
+                                                         NormalisableRange<float>(0, 127, 1, 1),
+                                                         0));
+        
+        // moves the band's threshold down from where Preserve puts it
+        layout.add(std::make_unique<AudioParameterFloat>("Threshold" + number,
+                                                         "Band " + number + " Threshold",
+                                                         NormalisableRange<float>(-24, 0, 0.01f, 1),
+                                                         0));
+        
+        layout.add(std::make_unique<AudioParameterFloat>("Gain" + number,
+                                                         "Band " + number + " Gain",
+                                                         NormalisableRange<float>(-24, 12, 0.01f, 1),
+                                                         0));
+    }
+    
+    return layout;
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+// (left out of the headless tools, which link both processors into one binary)
+#if ! OMNI_HEADLESS
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new OmniSmartClipAudioProcessor();
+}
+#endif
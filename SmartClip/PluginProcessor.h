@@ -1,91 +1,311 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-//==============================================================================
-/**
-*/
-class OmniSmartClipAudioProcessor  : public juce::AudioProcessor
-{
-public:
-    //==============================================================================
-    OmniSmartClipAudioProcessor();
-    ~OmniSmartClipAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-    
-    //odfjsifjosdjfoijfosijdf
-    
-    float remap (float value, float start1, float end1, float start2, float end2);
-    float analogClip(float input);
-    
-    // VALUE TREE STATE
-    using APVTS = juce::AudioProcessorValueTreeState;
-    static APVTS::ParameterLayout createParameterLayout();
-    
-    APVTS apvts{ *this, nullptr, "Parameters", createParameterLayout() };
-
-private:
-    
-    juce::dsp::Compressor<float> compressor;
-    
-    using Filter = juce::dsp::LinkwitzRileyFilter<float>;
-    Filter LP, HP;
-    
-    juce::AudioParameterFloat* drive { nullptr };
-    juce::AudioParameterFloat* preserve { nullptr };
-    
-    std::array<juce::AudioBuffer<float>, 2> filterBuffers;
-    
-    juce::dsp::Gain<float> inputGain, compressorInputGain, compressorOutputGain;
-    
-    template<typename T, typename U>
-    void applyGain(T& buffer, U& gain)
-    {
-        auto block = juce::dsp::AudioBlock<float>(buffer);
-        auto ctx = juce::dsp::ProcessContextReplacing<float>(block);
-        gain.process(ctx);
-    }
-    
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OmniSmartClipAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BandLimiter.h"
+#include "LinkwitzRileyLanes.h"
+#include "../Shared/ClipKernels.h"
+#include "../Shared/KernelDispatch.h"
+#include "../Shared/AntiderivativeClipper.h"
+#include "../Shared/ProcessorHelpers.h"
+#include "../Shared/ParameterRamp.h"
+#include "../Shared/StageTimer.h"
+#include "../Shared/LevelMeters.h"
+#include "../Shared/SpectrumAnalyzer.h"
+#include "../Shared/SilenceGate.h"
+#include "../Shared/LatencyReporter.h"
+#include "../Shared/ChannelWorkerPool.h"
+#include "../Shared/ClipOversampler.h"
+
+//==============================================================================
+/**
+*/
+class OmniSmartClipAudioProcessor  : public juce::AudioProcessor,
+                                     private juce::AudioProcessorValueTreeState::Listener
+{
+public:
+    //==============================================================================
+    OmniSmartClipAudioProcessor();
+    ~OmniSmartClipAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    
+    // the whole chain is templated on the sample type, so doubles run natively too
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    
+    //odfjsifjosdjfoijfosijdf
+    
+    // VALUE TREE STATE
+    using APVTS = juce::AudioProcessorValueTreeState;
+    static APVTS::ParameterLayout createParameterLayout();
+    
+    APVTS apvts{ *this, nullptr, "Parameters", createParameterLayout() };
+    
+    // largest layout the buses accept, 7.1.4 and 3rd order ambisonics both fit
+    static constexpr int maxChannels = 16;
+    
+    // what the last block spent in each stage, only recorded with OMNI_STAGE_TIMING.
+    // Every block is also published to the timer's ring, for one reader thread to drain
+    StageTimer& getStageTimer() { return stageTimer; }
+    
+    // the instruction set the kernels run with, picked in prepareToPlay
+    KernelDispatch::Isa getKernelIsa() const { return kernelIsa; }
+    
+    // levels and gain reduction for the editor, measured only while one is open
+    LevelMeters& getMeters() { return meters; }
+    
+    // the input and output spectra, analysed on a thread of its own while the editor is open
+    SpectrumAnalyzer& getAnalyzer() { return analyzer; }
+    
+    // where the crossover splits the bands at the current parameter values, lowest first
+    std::vector<float> getSplitFrequencies() const;
+    
+    // on by default, an instance whose input stays silent stops processing until
+    // signal comes back, see SilenceGate.h. Any thread
+    void setSleepEnabled(bool shouldSleep) { silenceGate.setEnabled(shouldSleep); }
+    
+    // whether the last block was skipped, only meaningful on the thread calling processBlock
+    bool isAsleep() const { return silenceGate.isSleeping(); }
+    
+    // The steady state curve of one band, from the input level to what reaches the
+    // output with only that band playing, and the input level its limiter starts at.
+    // They ignore attack and release and read nothing but the parameters, so the
+    // editor can call them from the message thread.
+    int getNumCurveBands() const;
+    bool isBandLimited(int band) const;
+    float getBandCurve(int band, float input) const;
+    float getBandThresholdLevel(int band) const;
+
+private:
+    
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    
+    // recalculates everything derived from the parameters, audio thread only
+    void updateParameters();
+    
+    // both processBlock()s, in the host's precision
+    template <typename Sample>
+    void processBuffer(juce::AudioBuffer<Sample>& buffer) noexcept;
+    
+    // one sub-block of at most ProcessorHelpers::subBlockSize samples through the
+    // band groups and the oversampled clip, buffer points at just that sub-block
+    template <typename Sample>
+    void processSubBlock(juce::AudioBuffer<Sample>& buffer, int numChannels, bool linked) noexcept;
+    
+    // moves every parameter ramp on, once the groups have each walked their own copy
+    void skipParameterRamps(int numSamples) noexcept;
+    
+    // true once the gain ramps, filters, limiters and the output of the block
+    // have all died away below SilenceGate::silenceThreshold
+    template <typename Sample>
+    bool hasDecayed(const juce::AudioBuffer<Sample>& buffer, int numChannels) noexcept;
+    
+    // clears every filter, limiter and oversampler of one chain
+    template <typename ChainType>
+    static void resetChain(ChainType& chain) noexcept;
+    
+    // the clipper on one channel, plain or antialiased, safe to call from the worker groups
+    template <typename Sample>
+    void clipChannel(int channel, Sample* data, int numSamples) noexcept;
+    
+    // switches oversampling tier and passes any change in latency, from
+    // oversampling or the limiters' lookahead, on to the host from the
+    // message thread, see LatencyReporter.h
+    void updateLatency();
+    
+    // points the crossover tree at the given split frequencies, lowest first
+    void setSplitFrequencies(const float* frequencies, int numSplits);
+    
+    // set by the listener whenever a parameter moves, and by prepareToPlay
+    std::atomic<bool> parametersChanged { true };
+    
+    // runs the whole chain over numChannels channels starting at firstChannel,
+    // see processSubBlock for how the channels are split up
+    template <typename Sample>
+    void processChannels(juce::AudioBuffer<Sample>& buffer, int firstChannel, int numChannels,
+                         bool linked, bool recordTimings) noexcept;
+    
+    static constexpr float compressorRatio = 100.0f;
+    static constexpr float maxLookaheadMs = 5.0f;
+    
+    // The normal mode is two bands split at 140 Hz, where only the low band is
+    // limited. Multiband mode splits into 2 to 6 bands, every one of them with
+    // its own limiter, Preserve, Threshold and Gain.
+    //
+    // Every band gets an input gain, a limiter and an output gain, and knows
+    // nothing about the other bands, so the limiter stage can work through
+    // them in any order.
+    static constexpr int maxBands = 6;
+    static constexpr float normalSplitFrequency = 140.0f;
+    
+    struct Band
+    {
+        // all in dB and all retargeted together, so the three follow Preserve in step
+        ParameterRamp threshold, inputGain, outputGain;
+        
+        // the high band of the normal mode goes straight to the sum
+        bool limited = false;
+    };
+    
+    // what Preserve and a band's trims map to, all in dB
+    struct BandSettings
+    {
+        float threshold = 0.0f, inputGain = 0.0f, outputGain = 0.0f;
+        bool limited = false;
+    };
+    
+    static BandSettings mapBandSettings(float preserveParam, float thresholdOffset, float gainOffset) noexcept;
+    BandSettings getBandSettings(int band) const;
+    
+    std::array<Band, maxBands> bands;
+    int numBands = 2;
+    bool multibandActive = false;
+    
+    juce::AudioParameterFloat* drive { nullptr };
+    juce::AudioParameterFloat* preserve { nullptr };
+    juce::AudioParameterBool* link { nullptr };
+    juce::AudioParameterBool* multiband { nullptr };
+    juce::AudioParameterChoice* oversampling { nullptr };
+    juce::AudioParameterBool* linearPhase { nullptr };
+    juce::AudioParameterChoice* antialiasing { nullptr };
+    juce::AudioParameterFloat* lookahead { nullptr };
+    juce::AudioParameterInt* bandCount { nullptr };
+    std::array<juce::AudioParameterFloat*, maxBands - 1> splits {};
+    std::array<juce::AudioParameterFloat*, maxBands> bandPreserve {}, bandThreshold {}, bandGain {};
+    
+    // Drive, in dB
+    ParameterRamp inputGain;
+    
+    // processChannels works through each sub-block in tiles of this many samples,
+    // which has to divide the sub-block so that no tile straddles two of them
+    static constexpr int tileSize = 64;
+    static_assert(ProcessorHelpers::subBlockSize % tileSize == 0);
+    
+    // Everything that holds audio, once for each precision, so float and
+    // double hosts both run natively and nothing is converted per sample.
+    // A host only picks its precision before prepareToPlay, but both are
+    // prepared and kept up to date so either is ready. The parameters, gain
+    // ramps and limiter envelopes are control signals and stay in float.
+    template <typename Sample>
+    struct Chain
+    {
+        // The crossover tree: split s divides what is left above the previous
+        // split into band s and the rest. Every band below the last split then
+        // goes through the allpass of each split above its own, so all bands have
+        // the same phase and sum back to a flat response.
+        //
+        // Going from N to N + 1 bands costs one more crossover, one more limiter
+        // and N - 1 more allpasses per channel. An allpass is half a crossover, so
+        // 6 bands run 5 crossovers, 10 allpasses and 6 limiters against the normal
+        // mode's 1 crossover and 1 limiter. Benchmark times every band count.
+        //
+        // The filters hold their channels in SIMD lanes, so one processSample()
+        // runs a whole block of channels (4 floats or 2 doubles with SSE or NEON)
+        // through a section.
+        using Filter = LinkwitzRileyLanes<Sample, maxChannels>;
+        using Lanes = typename Filter::Lanes;
+        std::array<Filter, maxBands - 1> crossovers;
+        std::array<std::array<Filter, maxBands - 1>, maxBands - 2> allpasses;   // [band][split above it]
+        
+        // one per band, limits each channel on its own, or all of them from one envelope when linked
+        std::array<BandLimiter<Sample>, maxBands> limiters;
+        
+        // Every band of the current tile is kept here for every channel, band-major, so a
+        // band's channels sit next to each other: bandArena[(band * maxChannels + channel) * tileSize]
+        std::array<Sample, maxBands * maxChannels * tileSize> bandArena;
+        
+        Sample* getBandTile(int band, int channel) noexcept { return bandArena.data() + (band * maxChannels + channel) * tileSize; }
+        
+        // runs the clipper above 1x when Oversampling is on, the rest of the chain stays at 1x
+        ClipOversampler<Sample> clipOversampler;
+    };
+    
+    Chain<float> floatChain;
+    Chain<double> doubleChain;
+    
+    template <typename Sample>
+    Chain<Sample>& getChain() noexcept
+    {
+        if constexpr (std::is_same_v<Sample, float>)
+            return floatChain;
+        else
+            return doubleChain;
+    }
+    
+    // settings are applied to both chains, fn takes either
+    template <typename Fn>
+    void forEachChain(Fn&& fn)
+    {
+        fn(floatChain);
+        fn(doubleChain);
+    }
+    
+    // ADAA, 0 for off or the order, and the previous inputs it works from
+    int antialiasingOrder = 0;
+    AntiderivativeClipper<maxChannels> antiderivativeClipper;
+    
+    // with more than this many unlinked channels, groups of them are handed to
+    // the worker pool, which every instance in the process shares. Groups are
+    // whole lane blocks, so no two threads share one.
+    static constexpr int channelsPerGroup = juce::jmax(4, LinkwitzRileyLanes<float, maxChannels>::laneWidth);
+    juce::SharedResourcePointer<ChannelWorkerPool> workers;
+    
+    // where the oversampling filters are designed, once for every instance in
+    // the process, see ClipOversampler.h. Only used from prepareToPlay
+    juce::SharedResourcePointer<SharedTableStore> tableStore;
+    
+    int preparedChannels = 0;
+    
+    // chosen once in prepareToPlay and handed to every kernel, see KernelDispatch.h
+    KernelDispatch::Isa kernelIsa = KernelDispatch::Isa::generic;
+    
+    enum Stage { parametersStage, gainStage, crossoverStage, limiterStage, sumStage, clipStage };
+    StageTimer stageTimer { "parameters", "gain", "crossover", "limiter", "sum", "clip" };
+    
+    LevelMeters meters;
+    SpectrumAnalyzer analyzer;
+    SilenceGate silenceGate;
+    LatencyReporter latencyReporter { *this };
+    
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OmniSmartClipAudioProcessor)
+};
@@ -0,0 +1,655 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless batch renderer. Renders audio files through SmartClip or 4-27
+    without a host, spreading the files over a pool of worker threads, and
+    reports the throughput at the end so render nodes can be sized.
+
+    Usage:
+        BatchRender --plugin smartclip|4-27 --out <folder>
+                    [--preset <preset.json>] [--set <ParameterID>=<value>]...
+                    [--threads <n>] [--block <samples>]
+                    [--chunk <seconds> [--preroll <seconds>] [--verify [--tolerance <dB>]]]
+                    <file or folder>...
+
+    A preset is a JSON object of parameter IDs to values, for example
+    { "Drive": 6.0, "Preserve": 64 }. --set is applied after the preset.
+    Output files keep the input's name, format and bit depth.
+
+    With --chunk, files are rendered one after another instead, each one
+    split into chunks of that many seconds that the workers render in
+    parallel, so a single long file uses every core. The filters, limiters
+    and ramps carry state from one sample to the next, so every chunk is
+    started --preroll seconds early (1 by default), with the worker's
+    processor prepared again to clear it, and that much output is thrown
+    away while the state settles to where a serial render would have it.
+    Chunks start on a block boundary of the serial render, so the blocks the
+    processor sees line up with it. The chunks are written out in order as
+    they finish, and no worker starts on a chunk more than twice the number
+    of workers past the last one written, so a slow chunk or a slow disk
+    can't pile the rest of the file up in memory.
+
+    --verify renders each file serially as well and compares the two. The
+    file fails if they differ by more than --tolerance (-90 dB by default),
+    and the speedup over the serial render is printed. It holds the whole
+    chunked render in memory to compare against.
+
+    Every processor is set to non-realtime, so SmartClip doesn't also split
+    the channels of each render over its worker pool.
+
+    See ../Common/HeadlessProcessors.h for how to build the tools.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../Common/HeadlessProcessors.h"
+
+namespace
+{
+    //==============================================================================
+    struct Settings
+    {
+        juce::String plugin;
+        juce::File outputFolder;
+        juce::var parameters { new juce::DynamicObject() };
+        int numThreads = juce::SystemStats::getNumCpus();
+        int blockSize = 512;
+        juce::Array<juce::File> inputFiles;
+
+        // 0 renders whole files, one per worker
+        double chunkSeconds = 0.0;
+        double prerollSeconds = 1.0;
+        bool verify = false;
+        float toleranceDecibels = -90.0f;
+    };
+
+    /** What one worker has done, the render time only counts processBlock. */
+    struct WorkerStats
+    {
+        int filesRendered = 0, filesFailed = 0, chunksRendered = 0;
+        double audioSeconds = 0.0, renderSeconds = 0.0;
+    };
+
+    juce::CriticalSection logLock;
+
+    void log (const juce::String& message)
+    {
+        const juce::ScopedLock sl (logLock);
+        std::cout << message << std::endl;
+    }
+
+    int fail (const juce::String& message)
+    {
+        std::cerr << "BatchRender: " << message << std::endl;
+        return 1;
+    }
+
+    //==============================================================================
+    juce::Result parseArguments (const juce::StringArray& args, const juce::AudioFormatManager& formats, Settings& settings)
+    {
+        auto* parameters = settings.parameters.getDynamicObject();
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i];
+            auto hasValue = i + 1 < args.size();
+
+            if (arg == "--verify")
+            {
+                settings.verify = true;
+                continue;
+            }
+
+            if (arg.startsWith("--") && ! hasValue)
+                return juce::Result::fail("missing value for " + arg);
+
+            if (arg == "--plugin")
+            {
+                settings.plugin = args[++i];
+            }
+            else if (arg == "--out")
+            {
+                settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            }
+            else if (arg == "--threads")
+            {
+                settings.numThreads = juce::jmax(1, args[++i].getIntValue());
+            }
+            else if (arg == "--block")
+            {
+                settings.blockSize = juce::jlimit(16, 65536, args[++i].getIntValue());
+            }
+            else if (arg == "--chunk")
+            {
+                settings.chunkSeconds = juce::jmax(0.0, args[++i].getDoubleValue());
+            }
+            else if (arg == "--preroll")
+            {
+                settings.prerollSeconds = juce::jmax(0.0, args[++i].getDoubleValue());
+            }
+            else if (arg == "--tolerance")
+            {
+                settings.toleranceDecibels = args[++i].getFloatValue();
+            }
+            else if (arg == "--preset")
+            {
+                auto presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+                auto preset = juce::JSON::parse(presetFile);
+
+                if (preset.getDynamicObject() == nullptr)
+                    return juce::Result::fail("couldn't read preset " + presetFile.getFullPathName());
+
+                for (auto& property : preset.getDynamicObject()->getProperties())
+                    parameters->setProperty(property.name, property.value);
+            }
+            else if (arg == "--set")
+            {
+                auto assignment = args[++i];
+
+                if (! assignment.containsChar('='))
+                    return juce::Result::fail("expected <ParameterID>=<value>, got " + assignment);
+
+                parameters->setProperty(assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                        assignment.fromFirstOccurrenceOf("=", false, false).getFloatValue());
+            }
+            else if (arg.startsWith("--"))
+            {
+                return juce::Result::fail("unknown option " + arg);
+            }
+            else
+            {
+                auto file = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+
+                if (file.isDirectory())
+                    settings.inputFiles.addArray(file.findChildFiles(juce::File::findFiles, false,
+                                                                     formats.getWildcardForAllFormats()));
+                else if (file.existsAsFile())
+                    settings.inputFiles.add(file);
+                else
+                    return juce::Result::fail("no such file " + file.getFullPathName());
+            }
+        }
+
+        if (settings.plugin.isEmpty())
+            return juce::Result::fail("--plugin is required (" + Headless::getProcessorNames().joinIntoString(", ") + ")");
+
+        if (settings.outputFolder == juce::File())
+            return juce::Result::fail("--out is required");
+
+        if (settings.inputFiles.isEmpty())
+            return juce::Result::fail("no input files");
+
+        if (settings.verify && settings.chunkSeconds <= 0.0)
+            return juce::Result::fail("--verify compares a chunked render, it needs --chunk");
+
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    /** Runs the reader's samples from start to end through the processor a block
+        at a time, handing each processed block to fn(buffer, position). Stops if
+        fn returns false. The time spent in processBlock is added to renderSeconds.
+    */
+    template <typename Fn>
+    bool renderRange (juce::AudioProcessor& processor, juce::AudioFormatReader& reader, int blockSize,
+                      juce::int64 start, juce::int64 end, double& renderSeconds, Fn&& fn)
+    {
+        auto numChannels = (int) reader.numChannels;
+        juce::AudioBuffer<float> buffer (numChannels, blockSize);
+        juce::MidiBuffer midi;
+
+        for (auto position = start; position < end; position += blockSize)
+        {
+            auto numSamples = (int) juce::jmin((juce::int64) blockSize, end - position);
+
+            buffer.setSize(numChannels, numSamples, false, false, true);
+            reader.read(&buffer, 0, numSamples, position, true, true);
+
+            auto blockStart = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            renderSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStart);
+
+            if (! fn(buffer, position))
+                return false;
+        }
+
+        return true;
+    }
+
+    /** Opens the output file for input, in the same format and bit depth. */
+    juce::Result createWriter (const juce::File& input, const juce::AudioFormatReader& reader, const Settings& settings,
+                               juce::AudioFormatManager& formats, std::unique_ptr<juce::AudioFormatWriter>& writer)
+    {
+        auto output = settings.outputFolder.getChildFile(input.getFileName());
+
+        if (output == input)
+            return juce::Result::fail("output would overwrite the input");
+
+        auto* format = formats.findFormatForFileExtension(output.getFileExtension());
+
+        output.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (output.createOutputStream());
+
+        if (format != nullptr && stream != nullptr)
+            writer.reset(format->createWriterFor(stream.get(), reader.sampleRate, reader.numChannels,
+                                                 (int) reader.bitsPerSample, reader.metadataValues, 0));
+
+        if (writer == nullptr)
+            return juce::Result::fail("couldn't create " + output.getFullPathName());
+
+        stream.release(); // now owned by the writer
+        return juce::Result::ok();
+    }
+
+    juce::Result prepareFor (juce::AudioProcessor& processor, const juce::AudioFormatReader& reader, const Settings& settings)
+    {
+        // the parallelism comes from the files and chunks, so SmartClip keeps
+        // every channel on the render thread instead of using its worker pool
+        processor.setNonRealtime(true);
+
+        if (! Headless::prepare(processor, (int) reader.numChannels, reader.sampleRate, settings.blockSize))
+            return juce::Result::fail(juce::String(reader.numChannels) + " channels is not a supported layout");
+
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    /** Renders one file with a processor owned by the calling worker. */
+    juce::Result renderFile (juce::AudioProcessor& processor, const juce::File& input, const Settings& settings,
+                             juce::AudioFormatManager& formats, WorkerStats& stats)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(input));
+
+        if (reader == nullptr)
+            return juce::Result::fail("unsupported file");
+
+        auto prepared = prepareFor(processor, *reader, settings);
+
+        if (prepared.failed())
+            return prepared;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        auto created = createWriter(input, *reader, settings, formats, writer);
+
+        if (created.failed())
+            return created;
+
+        double renderSeconds = 0.0;
+
+        auto written = renderRange(processor, *reader, settings.blockSize, 0, reader->lengthInSamples, renderSeconds,
+                                   [&] (const juce::AudioBuffer<float>& buffer, juce::int64)
+        {
+            return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+        });
+
+        if (! written)
+            return juce::Result::fail("write failed");
+
+        processor.releaseResources();
+
+        stats.audioSeconds += (double) reader->lengthInSamples / reader->sampleRate;
+        stats.renderSeconds += renderSeconds;
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    /** One piece of a file split up with --chunk, rendered by whichever worker claims it. */
+    struct Chunk
+    {
+        juce::int64 prerollStart = 0, start = 0, end = 0;
+        juce::AudioBuffer<float> output;
+        juce::String error;
+        std::atomic<bool> done { false };
+    };
+
+    /** Renders one chunk with the worker's processor, from the start of its
+        pre-roll, and keeps what comes out from the chunk's start onwards.
+    */
+    juce::Result renderChunk (juce::AudioProcessor& processor, const juce::File& input, const Settings& settings,
+                              juce::AudioFormatManager& formats, Chunk& chunk, WorkerStats& stats)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(input));
+
+        if (reader == nullptr)
+            return juce::Result::fail("unsupported file");
+
+        // prepared again for every chunk, which clears whatever the last chunk left in it
+        auto prepared = prepareFor(processor, *reader, settings);
+
+        if (prepared.failed())
+            return prepared;
+
+        chunk.output.setSize((int) reader->numChannels, (int) (chunk.end - chunk.start));
+        double renderSeconds = 0.0;
+
+        renderRange(processor, *reader, settings.blockSize, chunk.prerollStart, chunk.end, renderSeconds,
+                    [&] (const juce::AudioBuffer<float>& buffer, juce::int64 position)
+        {
+            // the pre-roll is a whole number of blocks, so no block straddles the chunk's start
+            if (position >= chunk.start)
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    chunk.output.copyFrom(channel, (int) (position - chunk.start), buffer, channel, 0, buffer.getNumSamples());
+
+            return true;
+        });
+
+        // the pre-roll's time counts, its audio doesn't, so the per core figures show what it costs
+        stats.audioSeconds += (double) (chunk.end - chunk.start) / reader->sampleRate;
+        stats.renderSeconds += renderSeconds;
+        ++stats.chunksRendered;
+        return juce::Result::ok();
+    }
+
+    /** Splits one file into chunks, renders them on numWorkers threads and writes
+        them out in order as they finish. With stitched, the whole output is also
+        copied into it for --verify.
+    */
+    juce::Result renderFileInChunks (const juce::File& input, const Settings& settings, juce::AudioFormatManager& formats,
+                                     std::vector<WorkerStats>& stats, juce::AudioBuffer<float>* stitched)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(input));
+
+        if (reader == nullptr)
+            return juce::Result::fail("unsupported file");
+
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        auto created = createWriter(input, *reader, settings, formats, writer);
+
+        if (created.failed())
+            return created;
+
+        // both rounded up to whole blocks, so every chunk and pre-roll starts on a
+        // block boundary of the serial render
+        auto toBlocks = [&] (double seconds)
+        {
+            auto blocks = (juce::int64) std::ceil(seconds * reader->sampleRate / settings.blockSize);
+            return blocks * settings.blockSize;
+        };
+
+        auto length = reader->lengthInSamples;
+        auto chunkSamples = juce::jmax((juce::int64) settings.blockSize, toBlocks(settings.chunkSeconds));
+        auto prerollSamples = toBlocks(settings.prerollSeconds);
+        auto numChunks = (int) ((length + chunkSamples - 1) / chunkSamples);
+
+        std::vector<Chunk> chunks ((size_t) numChunks);
+
+        for (int index = 0; index < numChunks; ++index)
+        {
+            auto& chunk = chunks[(size_t) index];
+            chunk.start = index * chunkSamples;
+            chunk.end = juce::jmin(length, chunk.start + chunkSamples);
+            chunk.prerollStart = juce::jmax((juce::int64) 0, chunk.start - prerollSamples);
+        }
+
+        if (stitched != nullptr)
+            stitched->setSize((int) reader->numChannels, (int) length);
+
+        auto numWorkers = juce::jmin((int) stats.size(), numChunks);
+        auto maxAhead = 2 * numWorkers;
+        std::atomic<int> nextChunk { 0 }, numWritten { 0 };
+        juce::WaitableEvent chunkFinished, chunkWritten;
+        juce::ThreadPool pool (juce::jmax(1, numWorkers));
+
+        // the chunks are claimed in order, and none more than maxAhead past the last
+        // one written, so at most that many are held in memory however the workers
+        // and the writer keep up with each other
+        for (int worker = 0; worker < numWorkers; ++worker)
+        {
+            pool.addJob([&, worker]
+            {
+                juce::AudioFormatManager workerFormats;
+                workerFormats.registerBasicFormats();
+
+                auto processor = Headless::createProcessor(settings.plugin);
+                Headless::setParameters(*processor, settings.parameters);
+
+                for (auto index = nextChunk++; index < numChunks; index = nextChunk++)
+                {
+                    while (index >= numWritten + maxAhead)
+                        chunkWritten.wait(10);
+
+                    auto& chunk = chunks[(size_t) index];
+                    auto result = renderChunk(*processor, input, settings, workerFormats, chunk, stats[(size_t) worker]);
+
+                    if (result.failed())
+                        chunk.error = result.getErrorMessage();
+
+                    chunk.done = true;
+                    chunkFinished.signal();
+                }
+
+                processor->releaseResources();
+            });
+        }
+
+        juce::String error;
+
+        for (auto& chunk : chunks)
+        {
+            while (! chunk.done)
+                chunkFinished.wait(50);
+
+            if (error.isEmpty())
+            {
+                if (chunk.error.isNotEmpty())
+                    error = chunk.error;
+                else if (! writer->writeFromAudioSampleBuffer(chunk.output, 0, chunk.output.getNumSamples()))
+                    error = "write failed";
+                else if (stitched != nullptr)
+                    for (int channel = 0; channel < chunk.output.getNumChannels(); ++channel)
+                        stitched->copyFrom(channel, (int) chunk.start, chunk.output, channel, 0, chunk.output.getNumSamples());
+            }
+
+            chunk.output.setSize(0, 0);
+            ++numWritten;
+            chunkWritten.signal();
+        }
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(5);
+
+        return error.isEmpty() ? juce::Result::ok() : juce::Result::fail(error);
+    }
+
+    /** Renders input serially with one processor, as renderFile does, and returns
+        the largest difference from stitched on any channel and sample.
+    */
+    juce::Result compareWithSerialRender (const juce::File& input, const Settings& settings, juce::AudioFormatManager& formats,
+                                          const juce::AudioBuffer<float>& stitched, float& maxDifference, double& renderSeconds)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(input));
+
+        if (reader == nullptr)
+            return juce::Result::fail("unsupported file");
+
+        auto processor = Headless::createProcessor(settings.plugin);
+        Headless::setParameters(*processor, settings.parameters);
+
+        auto prepared = prepareFor(*processor, *reader, settings);
+
+        if (prepared.failed())
+            return prepared;
+
+        maxDifference = 0.0f;
+
+        renderRange(*processor, *reader, settings.blockSize, 0, reader->lengthInSamples, renderSeconds,
+                    [&] (const juce::AudioBuffer<float>& buffer, juce::int64 position)
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            {
+                auto* serial = buffer.getReadPointer(channel);
+                auto* chunked = stitched.getReadPointer(channel, (int) position);
+
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    maxDifference = juce::jmax(maxDifference, std::abs(serial[i] - chunked[i]));
+            }
+
+            return true;
+        });
+
+        processor->releaseResources();
+        return juce::Result::ok();
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the processors' parameter state needs a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+
+    Settings settings;
+    auto parsed = parseArguments(args, formats, settings);
+
+    if (parsed.failed())
+        return fail(parsed.getErrorMessage());
+
+    // checks the plugin name and parameters once up front rather than in every worker
+    {
+        auto processor = Headless::createProcessor(settings.plugin);
+
+        if (processor == nullptr)
+            return fail("unknown plugin " + settings.plugin);
+
+        auto applied = Headless::setParameters(*processor, settings.parameters);
+
+        if (applied.failed())
+            return fail(applied.getErrorMessage());
+    }
+
+    if (! settings.outputFolder.createDirectory())
+        return fail("couldn't create " + settings.outputFolder.getFullPathName());
+
+    // with --chunk every worker takes part in every file, otherwise each takes whole files
+    auto chunked = settings.chunkSeconds > 0.0;
+    auto numWorkers = chunked ? settings.numThreads : juce::jmin(settings.numThreads, settings.inputFiles.size());
+    std::vector<WorkerStats> stats ((size_t) numWorkers);
+    WorkerStats files;
+    double verifySeconds = 0.0;
+    std::atomic<int> nextFile { 0 };
+
+    auto wallStart = juce::Time::getHighResolutionTicks();
+
+    if (chunked)
+    {
+        for (auto& input : settings.inputFiles)
+        {
+            juce::AudioBuffer<float> stitched;
+            auto fileStart = juce::Time::getHighResolutionTicks();
+            auto result = renderFileInChunks(input, settings, formats, stats, settings.verify ? &stitched : nullptr);
+            auto chunkedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - fileStart);
+            juce::String comparison;
+
+            // the serial render is only there to compare against, so it is left out of the wall time
+            if (result.wasOk() && settings.verify)
+            {
+                auto verifyStart = juce::Time::getHighResolutionTicks();
+                float maxDifference = 0.0f;
+                double serialSeconds = 0.0;
+
+                result = compareWithSerialRender(input, settings, formats, stitched, maxDifference, serialSeconds);
+                verifySeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - verifyStart);
+
+                auto differenceDecibels = juce::Decibels::gainToDecibels(maxDifference, -300.0f);
+
+                comparison = ", " + juce::String(differenceDecibels, 1) + " dB from the serial render, "
+                           + juce::String(serialSeconds / juce::jmax(chunkedSeconds, 1.0e-9), 1) + "x its speed";
+
+                if (result.wasOk() && differenceDecibels > settings.toleranceDecibels)
+                    result = juce::Result::fail("differs from the serial render by " + juce::String(differenceDecibels, 1)
+                                                + " dB, above " + juce::String(settings.toleranceDecibels, 1) + " dB");
+            }
+
+            if (result.wasOk())
+                ++files.filesRendered;
+            else
+                ++files.filesFailed;
+
+            log((result.wasOk() ? "rendered " : "FAILED   ") + input.getFileName()
+                + (result.wasOk() ? comparison : ": " + result.getErrorMessage()));
+        }
+    }
+    else
+    {
+        juce::ThreadPool pool (numWorkers);
+
+        // every worker keeps one processor and pulls files off the shared queue
+        // until it is empty
+        for (int worker = 0; worker < numWorkers; ++worker)
+        {
+            pool.addJob([&, worker]
+            {
+                auto& workerStats = stats[(size_t) worker];
+                auto processor = Headless::createProcessor(settings.plugin);
+                juce::AudioFormatManager workerFormats;
+                workerFormats.registerBasicFormats();
+
+                Headless::setParameters(*processor, settings.parameters);
+
+                for (auto index = nextFile++; index < settings.inputFiles.size(); index = nextFile++)
+                {
+                    auto& input = settings.inputFiles.getReference(index);
+                    auto result = renderFile(*processor, input, settings, workerFormats, workerStats);
+
+                    if (result.wasOk())
+                        ++workerStats.filesRendered;
+                    else
+                        ++workerStats.filesFailed;
+
+                    log((result.wasOk() ? "rendered " : "FAILED   ") + input.getFileName()
+                        + (result.wasOk() ? juce::String() : ": " + result.getErrorMessage()));
+                }
+            });
+        }
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(20);
+    }
+
+    auto wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - wallStart) - verifySeconds;
+
+    //==============================================================================
+    // throughput report
+    auto total = files;
+
+    for (auto& s : stats)
+    {
+        total.filesRendered += s.filesRendered;
+        total.filesFailed += s.filesFailed;
+        total.audioSeconds += s.audioSeconds;
+        total.renderSeconds += s.renderSeconds;
+    }
+
+    log("");
+    log("files rendered      " + juce::String(total.filesRendered) + ", failed " + juce::String(total.filesFailed));
+    log("workers             " + juce::String(numWorkers));
+    log("wall time           " + juce::String(wallSeconds, 2) + " s");
+    log("files / s           " + juce::String(total.filesRendered / juce::jmax(wallSeconds, 1.0e-9), 2));
+    log("realtime factor     " + juce::String(total.audioSeconds / juce::jmax(wallSeconds, 1.0e-9), 1)
+        + "x overall, including file i/o");
+
+    for (int worker = 0; worker < numWorkers; ++worker)
+    {
+        auto& s = stats[(size_t) worker];
+        log("  worker " + juce::String(worker).paddedLeft(' ', 2) + "         "
+            + juce::String(s.audioSeconds / juce::jmax(s.renderSeconds, 1.0e-9), 1)
+            + "x realtime in processBlock, " + (chunked ? juce::String(s.chunksRendered) + " chunks"
+                                                         : juce::String(s.filesRendered) + " files"));
+    }
+
+    log("per core            " + juce::String(total.audioSeconds / juce::jmax(total.renderSeconds, 1.0e-9), 1)
+        + "x realtime in processBlock");
+
+    return total.filesFailed == 0 ? 0 : 1;
+}
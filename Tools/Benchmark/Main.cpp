@@ -0,0 +1,1220 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Micro benchmarks for SmartClip and 4-27.
+
+    Every plugin is run headlessly at 44.1, 48, 96 and 192 kHz with block
+    sizes from 16 to 4096 samples, in mono and stereo. The whole processBlock
+    is timed, and so is each stage on its own, using the same dsp objects
+    and kernels the processors use:
+
+        SmartClip   gain, crossover, crossover lanes, allpass, compressor (the juce::dsp one it
+                    used to run), limiter, limiter linked, sum, clip, processBlock,
+                    and processBlock in multiband mode for 2 to 6 bands
+        4-27        gain, clip pow (the per-sample pow() curve the tables replaced),
+                    clip (one entry per curve accuracy), processBlock
+        both        processBlock double, the whole chain in double precision
+        both        processBlock idle, on silence once the processor has gone to sleep
+        both        the clipper oversampled at every tier, minimum and linear phase,
+                    and with first and second order ADAA
+        kernels     every curve in ../../Shared/ClipKernels.h on its own (power 2 to 8
+                    and the generic pow() one), the 4-27 table tiers and the morph
+                    between two curves, and the gain and sum stages, stereo at
+                    48 kHz, once for each instruction set variant the CPU can
+                    run (see ../../Shared/KernelDispatch.h)
+
+    The variant the processors pick is printed first and written to the
+    JSON. Every other entry uses that variant, so OMNI_KERNELS=<variant>
+    runs the whole benchmark with another one.
+
+    Before anything is timed every clip kernel, both 4-27 table tiers and
+    the 4-27 morph are checked against the reference curve, in float and
+    double and in every variant, and the run fails if any is off by more
+    than 1e-5 (1e-4 for the fast tier).
+
+    Before timing SmartClip, its limiter is null tested against
+    juce::dsp::Compressor with the same settings, and the run fails if the
+    difference is above -100 dB. Then its whole processBlock is null tested
+    against the chain it replaced, rebuilt from the juce::dsp Gain,
+    LinkwitzRileyFilter and Compressor it used, at the default settings and
+    at Drive 6, Preserve 64, in blocks of random size, to the same -100 dB.
+
+    Before timing either plugin, bursts of noise separated by silence are
+    run through one processor that sleeps through the silence and one that
+    never does (see ../../Shared/SilenceGate.h). Drive and Exponentiation
+    (Preserve for SmartClip) are moved in every silence once the first has
+    fallen asleep, so its ramps have to carry on while it sleeps. The run
+    fails if they differ by more than -100 dB, or if the first never fell
+    asleep before the parameters moved.
+    "processBlock idle" then times a processor that has gone to sleep.
+
+    Each plugin is also loaded as a session would, --instances of them
+    (200 by default) created and prepared in a row, once sharing their
+    tables (4-27's curves and both plugins' oversampling filters) through
+    ../../Shared/SharedTableStore.h and once with a copy each. Both times are printed with what the sharing saves in memory.
+
+    The results are ns/sample, cycles/sample and the realtime factor. They are
+    written as JSON so that runs from two builds can be diffed.
+
+    Usage:
+        Benchmark [--plugin smartclip|4-27] [--quick] [--instances <n>] [--out <results.json>]
+
+    See ../Common/HeadlessProcessors.h for how to build the tools.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../Common/HeadlessProcessors.h"
+
+#if JUCE_INTEL && JUCE_MSVC
+ #include <intrin.h>
+#elif JUCE_INTEL
+ #include <x86intrin.h>
+#endif
+
+namespace
+{
+    //==============================================================================
+    juce::uint64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return (juce::uint64) __rdtsc();
+       #else
+        return 0;
+       #endif
+    }
+
+    struct Config
+    {
+        double sampleRate;
+        int blockSize;
+        int numChannels;
+    };
+
+    struct Measurement
+    {
+        double nsPerSample = 0.0, cyclesPerSample = 0.0, realtimeFactor = 0.0;
+    };
+
+    /** Times fn, which processes one block of config.blockSize samples per call.
+
+        Runs enough calls for about a second of audio per channel (less with
+        --quick) after a warm up, and keeps the fastest of three rounds.
+    */
+    template <typename Fn>
+    Measurement measure (const Config& config, bool quick, Fn&& fn)
+    {
+        auto samplesPerRound = quick ? (1 << 15) : (1 << 18);
+        auto callsPerRound = juce::jmax(8, samplesPerRound / config.blockSize);
+
+        for (int i = 0; i < callsPerRound / 4; ++i)
+            fn();
+
+        Measurement best;
+        best.nsPerSample = std::numeric_limits<double>::max();
+
+        for (int round = 0; round < 3; ++round)
+        {
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            auto startCycles = readCycleCounter();
+
+            for (int i = 0; i < callsPerRound; ++i)
+                fn();
+
+            auto cycles = (double) (readCycleCounter() - startCycles);
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            auto numSamples = (double) callsPerRound * config.blockSize;
+
+            auto nsPerSample = seconds * 1.0e9 / numSamples;
+
+            if (nsPerSample < best.nsPerSample)
+            {
+                best.nsPerSample = nsPerSample;
+
+                // without a cycle counter this falls back to the nominal clock speed
+                best.cyclesPerSample = cycles > 0.0 ? cycles / numSamples
+                                                    : nsPerSample * juce::SystemStats::getCpuSpeedInMegahertz() * 1.0e-3;
+
+                best.realtimeFactor = (numSamples / config.sampleRate) / juce::jmax(seconds, 1.0e-12);
+            }
+        }
+
+        return best;
+    }
+
+    //==============================================================================
+    class Results
+    {
+    public:
+        void add (const juce::String& plugin, const juce::String& stage, const Config& config, const Measurement& m)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("plugin", plugin);
+            entry->setProperty("stage", stage);
+            entry->setProperty("sampleRate", config.sampleRate);
+            entry->setProperty("blockSize", config.blockSize);
+            entry->setProperty("channels", config.numChannels);
+            entry->setProperty("nsPerSample", m.nsPerSample);
+            entry->setProperty("cyclesPerSample", m.cyclesPerSample);
+            entry->setProperty("realtimeFactor", m.realtimeFactor);
+            results.add(juce::var(entry));
+
+            std::cout << plugin.paddedRight(' ', 10) << stage.paddedRight(' ', 20)
+                      << juce::String(config.sampleRate / 1000.0, 1).paddedLeft(' ', 6) << " kHz"
+                      << juce::String(config.blockSize).paddedLeft(' ', 6)
+                      << juce::String(config.numChannels).paddedLeft(' ', 3) << " ch"
+                      << juce::String(m.nsPerSample, 2).paddedLeft(' ', 10) << " ns/sample"
+                      << juce::String(m.cyclesPerSample, 1).paddedLeft(' ', 8) << " cycles/sample"
+                      << juce::String(m.realtimeFactor, 0).paddedLeft(' ', 10) << "x realtime" << std::endl;
+        }
+
+        juce::String toJSON() const
+        {
+            auto* root = new juce::DynamicObject();
+            root->setProperty("cpu", juce::SystemStats::getCpuModel());
+            root->setProperty("cpuMHz", juce::SystemStats::getCpuSpeedInMegahertz());
+            root->setProperty("kernels", kernels);
+            root->setProperty("results", results);
+            return juce::JSON::toString(juce::var(root));
+        }
+
+        /** The kernel variant the processors picked, see KernelDispatch.h. */
+        void setKernels (const juce::String& name)      { kernels = name; }
+
+    private:
+        juce::Array<juce::var> results;
+        juce::String kernels;
+    };
+
+    //==============================================================================
+    template <typename Sample>
+    void fillWithNoise (juce::AudioBuffer<Sample>& buffer, juce::Random& random)
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+                buffer.setSample(channel, sample, (Sample) ((random.nextFloat() * 2.0f - 1.0f) * 0.5f));
+    }
+
+    juce::dsp::ProcessSpec specFor (const Config& config)
+    {
+        return { config.sampleRate, (juce::uint32) config.blockSize, (juce::uint32) config.numChannels };
+    }
+
+    /** Times the complete processBlock of a headless processor, in float or double. */
+    template <typename Sample = float>
+    void benchmarkProcessor (const juce::String& plugin, const juce::String& stage, const Config& config, bool quick,
+                             const juce::var& parameters, Results& results, bool silentInput = false)
+    {
+        auto processor = Headless::createProcessor(plugin);
+        Headless::setParameters(*processor, parameters);
+
+        auto precision = std::is_same_v<Sample, double> ? juce::AudioProcessor::doublePrecision
+                                                        : juce::AudioProcessor::singlePrecision;
+
+        if (! Headless::prepare(*processor, config.numChannels, config.sampleRate, config.blockSize, precision))
+            return;
+
+        juce::AudioBuffer<Sample> source (config.numChannels, config.blockSize), buffer (source);
+        juce::MidiBuffer midi;
+        juce::Random random (1);
+
+        // silence lets the processor fall asleep during the warm up, so it times the idle cost
+        if (silentInput)
+            source.clear();
+        else
+            fillWithNoise(source, random);
+
+        results.add(plugin, stage, config, measure(config, quick, [&]
+        {
+            buffer.makeCopyOf(source, true);
+            processor->processBlock(buffer, midi);
+        }));
+
+        processor->releaseResources();
+    }
+
+    /** Times a clipper run through every oversampling tier, minimum and linear phase. */
+    template <typename Fn>
+    void benchmarkOversampling (const juce::String& plugin, const Config& config, bool quick,
+                                Results& results, Fn&& nonlinearity)
+    {
+        juce::AudioBuffer<float> source (config.numChannels, config.blockSize), buffer (source);
+        juce::Random random (1);
+        fillWithNoise(source, random);
+
+        juce::SharedResourcePointer<SharedTableStore> store;
+        ClipOversampler<float> oversampler;
+        oversampler.prepare(config.numChannels, config.blockSize, *store);
+
+        auto tierNames = ClipOversampler<float>::getTierNames();
+
+        for (int tier = 1; tier < ClipOversampler<float>::numTiers; ++tier)
+        {
+            for (auto linearPhase : { false, true })
+            {
+                oversampler.select(tier, linearPhase);
+
+                results.add(plugin, "os " + tierNames[tier] + (linearPhase ? " linear" : " min"), config,
+                            measure(config, quick, [&]
+                {
+                    buffer.makeCopyOf(source, true);
+                    oversampler.process(juce::dsp::AudioBlock<float>(buffer), nonlinearity);
+                }));
+            }
+        }
+    }
+
+    /** Times a clipper curve with first and second order ADAA. */
+    template <typename Curve>
+    void benchmarkAntialiasing (const juce::String& plugin, const Config& config, bool quick,
+                                Results& results, const Curve& curve)
+    {
+        juce::AudioBuffer<float> source (config.numChannels, config.blockSize), buffer (source);
+        juce::Random random (1);
+        fillWithNoise(source, random);
+
+        AntiderivativeClipper<2> clipper;
+
+        for (int order = 1; order <= 2; ++order)
+        {
+            results.add(plugin, "adaa " + juce::String(order), config, measure(config, quick, [&]
+            {
+                for (int channel = 0; channel < config.numChannels; ++channel)
+                {
+                    juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel), source.getReadPointer(channel),
+                                                          3.0f, config.blockSize);
+                    clipper.process(curve, channel, buffer.getWritePointer(channel), config.blockSize, order);
+                }
+            }));
+        }
+    }
+
+    //==============================================================================
+    void benchmarkSmartClipStages (const Config& config, bool quick, KernelDispatch::Isa isa, Results& results)
+    {
+        auto spec = specFor(config);
+        auto numChannels = config.numChannels, numSamples = config.blockSize;
+
+        juce::AudioBuffer<float> source (numChannels, numSamples), low (source), high (source);
+        juce::Random random (1);
+        fillWithNoise(source, random);
+
+        // gain, kept ramping so the ramp cost is included, a tile at a time as the processor runs it
+        ParameterRamp gain;
+        gain.reset(config.sampleRate, 0.05);
+        std::array<float, ProcessorHelpers::subBlockSize> gains;
+        auto target = 6.0f;
+
+        results.add("smartclip", "gain", config, measure(config, quick, [&]
+        {
+            if (! gain.isRamping())
+                gain.setTarget(target = 6.0f - target);
+
+            ProcessorHelpers::forEachSubBlock(numSamples, [&] (int start, int length)
+            {
+                gain.fillGain(isa, gains.data(), length);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    juce::FloatVectorOperations::copy(low.getWritePointer(channel, start), source.getReadPointer(channel, start), length);
+                    KernelDispatch::multiply(isa, low.getWritePointer(channel, start), gains.data(), length);
+                }
+            });
+        }));
+
+        // crossover, both bands from one filter
+        juce::dsp::LinkwitzRileyFilter<float> crossover;
+        crossover.prepare(spec);
+        crossover.setCutoffFrequency(140);
+
+        results.add("smartclip", "crossover", config, measure(config, quick, [&]
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* in = source.getReadPointer(channel);
+                auto* lo = low.getWritePointer(channel);
+                auto* hi = high.getWritePointer(channel);
+
+                for (int sample = 0; sample < numSamples; ++sample)
+                    crossover.processSample(channel, in[sample], lo[sample], hi[sample]);
+            }
+        }));
+
+        // the same crossover with the channels in SIMD lanes, as the processor runs it
+        LinkwitzRileyLanes<float, 2> crossoverLanes;
+        crossoverLanes.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        crossoverLanes.prepare(spec);
+        crossoverLanes.setCutoffFrequency(140);
+
+        using Lanes = decltype(crossoverLanes)::Lanes;
+        constexpr auto laneWidth = decltype(crossoverLanes)::laneWidth;
+
+        results.add("smartclip", "crossover lanes", config, measure(config, quick, [&]
+        {
+            alignas (sizeof (Lanes)) std::array<float, laneWidth> in {}, lo, hi;
+
+            for (int blockStart = 0; blockStart < numChannels; blockStart += laneWidth)
+            {
+                auto numLanes = juce::jmin(laneWidth, numChannels - blockStart);
+
+                for (int sample = 0; sample < numSamples; ++sample)
+                {
+                    for (int lane = 0; lane < numLanes; ++lane)
+                        in[(size_t) lane] = source.getReadPointer(blockStart + lane)[sample];
+
+                    Lanes lowLanes, highLanes;
+                    crossoverLanes.processSample(blockStart / laneWidth, Lanes::fromRawArray(in.data()), lowLanes, highLanes);
+                    lowLanes.copyToRawArray(lo.data());
+                    highLanes.copyToRawArray(hi.data());
+
+                    for (int lane = 0; lane < numLanes; ++lane)
+                    {
+                        low.getWritePointer(blockStart + lane)[sample] = lo[(size_t) lane];
+                        high.getWritePointer(blockStart + lane)[sample] = hi[(size_t) lane];
+                    }
+                }
+            }
+        }));
+
+        // one allpass of the multiband tree, every band below a split runs one per split above it
+        juce::dsp::LinkwitzRileyFilter<float> allpass;
+        allpass.prepare(spec);
+        allpass.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+        allpass.setCutoffFrequency(2000);
+
+        results.add("smartclip", "allpass", config, measure(config, quick, [&]
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* in = source.getReadPointer(channel);
+                auto* out = low.getWritePointer(channel);
+
+                for (int sample = 0; sample < numSamples; ++sample)
+                    out[sample] = allpass.processSample(channel, in[sample]);
+            }
+        }));
+
+        // low band compressor, with the Preserve = 64 threshold so it is working
+        juce::dsp::Compressor<float> compressor;
+        compressor.prepare(spec);
+        compressor.setRelease(30);
+        compressor.setAttack(0);
+        compressor.setRatio(100);
+        compressor.setThreshold(-2.0f);
+
+        results.add("smartclip", "compressor", config, measure(config, quick, [&]
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* in = source.getReadPointer(channel);
+                auto* out = low.getWritePointer(channel);
+
+                for (int sample = 0; sample < numSamples; ++sample)
+                    out[sample] = compressor.processSample(channel, in[sample]);
+            }
+        }));
+
+        // the limiter that replaced it, per channel and linked
+        BandLimiter<float> limiter;
+        limiter.prepare(config.sampleRate, numChannels, 0);
+        limiter.setRelease(30);
+        limiter.setRatio(100);
+        limiter.setThreshold(-2.0f);
+
+        std::vector<float> unity ((size_t) numSamples, 1.0f);
+
+        results.add("smartclip", "limiter", config, measure(config, quick, [&]
+        {
+            low.makeCopyOf(source, true);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                limiter.process(channel, low.getWritePointer(channel), unity.data(), numSamples);
+        }));
+
+        results.add("smartclip", "limiter linked", config, measure(config, quick, [&]
+        {
+            low.makeCopyOf(source, true);
+            limiter.processLinked(low.getArrayOfWritePointers(), numChannels, unity.data(), numSamples);
+        }));
+
+        // band sum
+        results.add("smartclip", "sum", config, measure(config, quick, [&]
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                juce::FloatVectorOperations::copy(low.getWritePointer(channel), source.getReadPointer(channel), numSamples);
+                KernelDispatch::add(isa, low.getWritePointer(channel), high.getReadPointer(channel), numSamples);
+            }
+        }));
+
+        // cubic clipper
+        results.add("smartclip", "clip", config, measure(config, quick, [&]
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                juce::FloatVectorOperations::multiply(low.getWritePointer(channel), source.getReadPointer(channel),
+                                                      3.0f, numSamples);
+                ClipKernels::cubicClip(isa, low.getWritePointer(channel), numSamples);
+            }
+        }));
+
+        benchmarkOversampling("smartclip", config, quick, results, [isa] (int, float* data, int n)
+        {
+            juce::FloatVectorOperations::multiply(data, 3.0f, n);
+            ClipKernels::cubicClip(isa, data, n);
+        });
+
+        benchmarkAntialiasing("smartclip", config, quick, results, ClipKernels::cubicCurve);
+    }
+
+    /** Runs the SmartClip band limiter and juce::dsp::Compressor with the same
+        settings over bursts of noise at different levels, and returns the
+        largest difference between them in dB relative to full scale.
+    */
+    double limiterNullTest()
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512, numBlocks = 2000;
+
+        juce::dsp::Compressor<float> compressor;
+        compressor.prepare({ sampleRate, (juce::uint32) blockSize, 1 });
+        compressor.setRelease(30);
+        compressor.setAttack(0);
+        compressor.setRatio(100);
+        compressor.setThreshold(-2.0f);
+
+        BandLimiter<float> limiter;
+        limiter.prepare(sampleRate, 1, 0);
+        limiter.setRelease(30);
+        limiter.setRatio(100);
+        limiter.setThreshold(-2.0f);
+
+        std::vector<float> unity (blockSize, 1.0f), reference (blockSize), output (blockSize);
+        juce::Random random (1);
+        double maxDifference = 0.0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // from well under the threshold to 24 dB over it
+            auto level = juce::Decibels::decibelsToGain(-30.0f + 54.0f * random.nextFloat());
+
+            for (int sample = 0; sample < blockSize; ++sample)
+                output[(size_t) sample] = (random.nextFloat() * 2.0f - 1.0f) * level;
+
+            for (int sample = 0; sample < blockSize; ++sample)
+                reference[(size_t) sample] = compressor.processSample(0, output[(size_t) sample]);
+
+            limiter.process(0, output.data(), unity.data(), blockSize);
+
+            for (int sample = 0; sample < blockSize; ++sample)
+                maxDifference = juce::jmax(maxDifference, (double) std::abs(output[(size_t) sample] - reference[(size_t) sample]));
+        }
+
+        return juce::Decibels::gainToDecibels(maxDifference, -300.0);
+    }
+
+    /** Runs SmartClip's processBlock against the chain it replaced, rebuilt from
+        the juce::dsp parts that chain was made of: Gain, LinkwitzRileyFilter low
+        and high pass at 140 Hz each on its own copy, Compressor with attack 0,
+        release 30 and ratio 100 on the low band, the bands summed and the pow()
+        cubic clip, with Preserve mapped as it was. The input is a 60 Hz sine and
+        noise at levels that change every 0.1 s, in blocks of random size, and the
+        largest difference is returned in dB. The first second isn't compared:
+        the processor's gain ramps start from 0 dB and the old Gains from silence.
+    */
+    double chainNullTest (float drive, float preserve)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numChannels = 2, maxBlockSize = 512, numSeconds = 10;
+        constexpr int segmentLength = (int) (0.1 * sampleRate), settleLength = (int) sampleRate;
+
+        auto processor = Headless::createProcessor("smartclip");
+        Headless::setParameter(*processor, "Drive", drive);
+        Headless::setParameter(*processor, "Preserve", preserve);
+        Headless::prepare(*processor, numChannels, sampleRate, maxBlockSize);
+
+        juce::dsp::ProcessSpec spec { sampleRate, (juce::uint32) maxBlockSize, (juce::uint32) numChannels };
+        juce::dsp::LinkwitzRileyFilter<float> lowPass, highPass;
+        juce::dsp::Gain<float> inputGain, compressorInputGain, compressorOutputGain;
+        juce::dsp::Compressor<float> compressor;
+
+        lowPass.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        highPass.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+
+        for (auto* filter : { &lowPass, &highPass })
+        {
+            filter->prepare(spec);
+            filter->setCutoffFrequency(140.0f);
+        }
+
+        const std::pair<juce::dsp::Gain<float>*, float> gains[] = {
+            { &inputGain, drive },
+            { &compressorInputGain, ProcessorHelpers::remap(preserve, 0, 127, -20.0, 0) },
+            { &compressorOutputGain, ProcessorHelpers::remap(preserve, 0, 127, 19.5, 0) } };
+
+        for (auto& gain : gains)
+        {
+            gain.first->prepare(spec);
+            gain.first->setRampDurationSeconds(0.0);
+            gain.first->setGainDecibels(gain.second);
+        }
+
+        compressor.prepare(spec);
+        compressor.setRelease(30);
+        compressor.setAttack(0);
+        compressor.setRatio(100);
+        compressor.setThreshold(ProcessorHelpers::remap(preserve, 0, 127, 0.00, -4.00));
+
+        juce::AudioBuffer<float> output (numChannels, maxBlockSize), reference (output), low (output), high (output);
+        juce::MidiBuffer midi;
+        juce::Random random (1);
+        float sineLevel = 0.0f, noiseLevel = 0.0f;
+        double phase = 0.0, maxDifference = 0.0;
+
+        for (int position = 0; position < numSeconds * (int) sampleRate;)
+        {
+            auto numSamples = juce::jmin(1 + random.nextInt(maxBlockSize), numSeconds * (int) sampleRate - position);
+            output.setSize(numChannels, numSamples, false, false, true);
+
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                // from well under the low band's threshold to far over it
+                if ((position + sample) % segmentLength == 0)
+                {
+                    sineLevel = juce::Decibels::decibelsToGain(-30.0f + 54.0f * random.nextFloat());
+                    noiseLevel = juce::Decibels::decibelsToGain(-30.0f + 54.0f * random.nextFloat());
+                }
+
+                auto sine = sineLevel * (float) std::sin(phase);
+                phase = std::fmod(phase + juce::MathConstants<double>::twoPi * 60.0 / sampleRate, juce::MathConstants<double>::twoPi);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    output.setSample(channel, sample, sine + (random.nextFloat() * 2.0f - 1.0f) * noiseLevel);
+            }
+
+            reference.makeCopyOf(output, true);
+            processor->processBlock(output, midi);
+
+            // the old chain, a pass over the block for every step
+            juce::dsp::AudioBlock<float> block (reference), lowBlock, highBlock;
+            inputGain.process(juce::dsp::ProcessContextReplacing<float>(block));
+
+            low.makeCopyOf(reference, true);
+            high.makeCopyOf(reference, true);
+            lowBlock = juce::dsp::AudioBlock<float>(low);
+            highBlock = juce::dsp::AudioBlock<float>(high);
+
+            lowPass.process(juce::dsp::ProcessContextReplacing<float>(lowBlock));
+            highPass.process(juce::dsp::ProcessContextReplacing<float>(highBlock));
+
+            compressorInputGain.process(juce::dsp::ProcessContextReplacing<float>(lowBlock));
+            compressor.process(juce::dsp::ProcessContextReplacing<float>(lowBlock));
+            compressorOutputGain.process(juce::dsp::ProcessContextReplacing<float>(lowBlock));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                reference.copyFrom(channel, 0, low, channel, 0, numSamples);
+                reference.addFrom(channel, 0, high, channel, 0, numSamples);
+
+                for (int sample = 0; sample < numSamples; ++sample)
+                {
+                    double value = reference.getSample(channel, sample);
+                    value = value > 1.5 ? 1.0 : value < -1.5 ? -1.0 : value - (4.0 / 27.0) * std::pow(value, 3);
+
+                    if (position + sample >= settleLength)
+                        maxDifference = juce::jmax(maxDifference, std::abs((double) output.getSample(channel, sample) - (double) (float) value));
+                }
+            }
+
+            position += numSamples;
+        }
+
+        processor->releaseResources();
+        return juce::Decibels::gainToDecibels(maxDifference, -300.0);
+    }
+
+    /** Creates and prepares numInstances of a plugin one after the other, as a
+        session opening, and returns the seconds it took. With share off every
+        instance builds tables of its own, as before SharedTableStore. stats is
+        what the store holds with all of them still open.
+    */
+    double instanceLoadTime (const juce::String& plugin, int numInstances, bool share, SharedTableStore::Stats& stats)
+    {
+        juce::SharedResourcePointer<SharedTableStore> store;
+        store->setSharingEnabled(share);
+
+        std::vector<std::unique_ptr<juce::AudioProcessor>> instances;
+        auto start = juce::Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            instances.push_back(Headless::createProcessor(plugin));
+            Headless::prepare(*instances.back(), 2, 48000.0, 512);
+        }
+
+        auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+        stats = store->getStats();
+
+        instances.clear();
+        store->setSharingEnabled(true);
+        return seconds;
+    }
+
+    /** Runs bursts of noise with stretches of silence between them through two
+        processors with the same settings, one that sleeps through the silence and
+        one that never does, and returns their largest difference in dB. Drive and
+        the curve parameter are moved a quarter of the way into each silence, once
+        the sleeping one has gone to sleep, so the ramps have to carry on while
+        asleep. fractionAsleep is set to the fraction of blocks the sleeping one
+        skipped and numMovedAsleep to how many silences the parameters moved in
+        while it slept, so a gate that never sleeps can't pass.
+    */
+    double sleepNullTest (const juce::String& plugin, double& fractionAsleep, int& numMovedAsleep)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numChannels = 2, maxBlockSize = 512, numBursts = 12;
+
+        auto isSmartClip = plugin.equalsIgnoreCase("smartclip");
+        auto sleeping = Headless::createProcessor(plugin), awake = Headless::createProcessor(plugin);
+        Headless::setSleepEnabled(*awake, false);
+
+        for (auto* processor : { sleeping.get(), awake.get() })
+        {
+            // oversampling and the lookahead both delay the tail the gate has to wait out
+            Headless::setParameter(*processor, "Drive", 6.0f);
+            Headless::setParameter(*processor, isSmartClip ? "Preserve" : "Exponentiation", isSmartClip ? 64.0f : 50.0f);
+            Headless::setParameter(*processor, "Oversampling", 1.0f);
+
+            if (isSmartClip)
+                Headless::setParameter(*processor, "Lookahead", 2.0f);
+
+            Headless::prepare(*processor, numChannels, sampleRate, maxBlockSize);
+        }
+
+        juce::AudioBuffer<float> first (numChannels, maxBlockSize), second (numChannels, maxBlockSize);
+        juce::MidiBuffer midi;
+        juce::Random random (1);
+        double maxDifference = 0.0;
+        int numBlocks = 0, numAsleep = 0;
+        numMovedAsleep = 0;
+
+        for (int burst = 0; burst < numBursts; ++burst)
+        {
+            // 0.25 s of noise starting anywhere in a block, then 1 s of digital silence
+            auto noiseLength = (int) (0.25 * sampleRate), silenceLength = (int) (1.0 * sampleRate);
+            auto level = juce::Decibels::decibelsToGain(-24.0f + 24.0f * random.nextFloat());
+            auto moved = false;
+
+            for (int position = 0; position < noiseLength + silenceLength;)
+            {
+                auto numSamples = juce::jmin(1 + random.nextInt(maxBlockSize), noiseLength + silenceLength - position);
+                first.setSize(numChannels, numSamples, false, false, true);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    for (int sample = 0; sample < numSamples; ++sample)
+                        first.setSample(channel, sample, position + sample < noiseLength
+                                                             ? (random.nextFloat() * 2.0f - 1.0f) * level : 0.0f);
+
+                second.makeCopyOf(first, true);
+                sleeping->processBlock(first, midi);
+                awake->processBlock(second, midi);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    for (int sample = 0; sample < numSamples; ++sample)
+                        maxDifference = juce::jmax(maxDifference, (double) std::abs(first.getSample(channel, sample)
+                                                                                    - second.getSample(channel, sample)));
+
+                auto asleep = Headless::isAsleep(*sleeping);
+                numAsleep += asleep ? 1 : 0;
+                ++numBlocks;
+                position += numSamples;
+
+                // both get the change before the same block, so any difference is the sleep's
+                if (asleep && ! moved && position >= noiseLength + silenceLength / 4)
+                {
+                    auto drive = 12.0f * random.nextFloat();
+                    auto curve = (isSmartClip ? 127.0f : 100.0f) * random.nextFloat();
+
+                    for (auto* processor : { sleeping.get(), awake.get() })
+                    {
+                        Headless::setParameter(*processor, "Drive", drive);
+                        Headless::setParameter(*processor, isSmartClip ? "Preserve" : "Exponentiation", curve);
+                    }
+
+                    moved = true;
+                    ++numMovedAsleep;
+                }
+            }
+        }
+
+        fractionAsleep = (double) numAsleep / (double) juce::jmax(1, numBlocks);
+        return juce::Decibels::gainToDecibels(maxDifference, -300.0);
+    }
+
+    void benchmark427Stages (const Config& config, bool quick, const CurveTable& curves, KernelDispatch::Isa isa,
+                             Results& results)
+    {
+        auto numChannels = config.numChannels, numSamples = config.blockSize;
+
+        juce::AudioBuffer<float> source (numChannels, numSamples), buffer (source);
+        juce::Random random (1);
+        fillWithNoise(source, random);
+
+        ParameterRamp gain;
+        gain.reset(config.sampleRate, 0.05);
+        std::array<float, ProcessorHelpers::subBlockSize> gains;
+        auto target = 6.0f;
+
+        // retargeted every block so the ramp is always moving, a sub-block at a time as the processor runs it
+        results.add("4-27", "gain", config, measure(config, quick, [&]
+        {
+            gain.setTarget(target = 6.0f - target);
+
+            ProcessorHelpers::forEachSubBlock(numSamples, [&] (int start, int length)
+            {
+                gain.fillGain(isa, gains.data(), length);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    juce::FloatVectorOperations::copy(buffer.getWritePointer(channel, start), source.getReadPointer(channel, start), length);
+                    KernelDispatch::multiply(isa, buffer.getWritePointer(channel, start), gains.data(), length);
+                }
+            });
+        }));
+
+        const std::pair<CurveTable::Accuracy, const char*> tiers[] = { { CurveTable::Accuracy::exact, "clip exact" },
+                                                                       { CurveTable::Accuracy::high, "clip high" },
+                                                                       { CurveTable::Accuracy::fast, "clip fast" } };
+
+        // the per-sample pow() the tiers replaced, so the speedup can be tracked from build to build
+        results.add("4-27", "clip pow", config, measure(config, quick, [&]
+        {
+            auto n = CurveTable::exponentFor(50);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* data = buffer.getWritePointer(channel);
+                auto* input = source.getReadPointer(channel);
+
+                for (int sample = 0; sample < numSamples; ++sample)
+                    data[sample] = (float) CurveTable::processSampleReference(input[sample] * 3.0f, n);
+            }
+        }));
+
+        for (auto& tier : tiers)
+        {
+            results.add("4-27", tier.second, config, measure(config, quick, [&]
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel), source.getReadPointer(channel),
+                                                          3.0f, numSamples);
+                    curves.process(buffer.getWritePointer(channel), numSamples, 50, tier.first, isa);
+                }
+            }));
+        }
+
+        benchmarkOversampling("4-27", config, quick, results, [&curves, isa] (int, float* data, int n)
+        {
+            juce::FloatVectorOperations::multiply(data, 3.0f, n);
+            curves.process(data, n, 50, CurveTable::Accuracy::high, isa);
+        });
+
+        benchmarkAntialiasing("4-27", config, quick, results, curves.getClipCurve(50));
+    }
+    //==============================================================================
+    /** Checks every clip kernel against CurveTable::processSampleReference, in
+        float and double and in every variant this CPU can run, over the whole
+        curve and past the threshold:
+
+            every ClipKernels curve, including the hand written cubic kernels
+            as clip() routes n = 3 to them, to within 1e-5
+            every 4-27 curve in the high and fast table tiers, to within 1e-5
+            and 1e-4 (roughly -100 dB and -80 dB, as the tiers are documented)
+            processMorph() between every pair of neighbouring curves, against
+            the same crossfade of their reference curves, to the same limits
+
+        Prints the largest error of each and returns false if any is over.
+    */
+    bool kernelCheck (const CurveTable& curves)
+    {
+        constexpr int numPoints = 4096;
+        double kernelError = 0.0, highError = 0.0, fastError = 0.0, morphHighError = 0.0, morphFastError = 0.0;
+
+        // runs fn(isa, output) on a copy of input for every supported variant,
+        // in float and double, and returns the largest difference from reference
+        auto measure = [] (const std::vector<double>& input, const std::vector<double>& reference, auto&& fn)
+        {
+            double maxError = 0.0;
+
+            auto checkSamples = [&] (auto sampleType)
+            {
+                using Sample = decltype(sampleType);
+                std::vector<Sample> output (input.size());
+
+                for (auto isa : KernelDispatch::allIsas)
+                {
+                    if (! KernelDispatch::isSupported(isa))
+                        continue;
+
+                    for (size_t i = 0; i < input.size(); ++i)
+                        output[i] = (Sample) input[i];
+
+                    fn(isa, output.data(), (int) output.size());
+
+                    for (size_t i = 0; i < input.size(); ++i)
+                        maxError = juce::jmax(maxError, std::abs((double) output[i] - reference[i]));
+                }
+            };
+
+            checkSamples(0.0f);
+            checkSamples(0.0);
+            return maxError;
+        };
+
+        // both signs, from zero to 1.2 times the threshold
+        auto sweep = [] (double threshold)
+        {
+            std::vector<double> input;
+
+            for (int i = 0; i <= numPoints; ++i)
+                input.push_back(threshold * (2.4 * i / numPoints - 1.2));
+
+            return input;
+        };
+
+        auto referenceFor = [] (const std::vector<double>& input, double n)
+        {
+            std::vector<double> reference;
+
+            for (auto x : input)
+                reference.push_back(CurveTable::processSampleReference(x, n));
+
+            return reference;
+        };
+
+        auto checkKernel = [&] (const auto& curve)
+        {
+            auto input = sweep(curve.threshold);
+
+            kernelError = juce::jmax(kernelError, measure(input, referenceFor(input, curve.exponent), [&] (auto isa, auto* data, int n)
+            {
+                ClipKernels::clip(isa, curve, data, n);
+            }));
+        };
+
+        checkKernel(ClipKernels::PowerCurve<2> {});
+        checkKernel(ClipKernels::PowerCurve<3> {});
+        checkKernel(ClipKernels::PowerCurve<4> {});
+        checkKernel(ClipKernels::PowerCurve<5> {});
+        checkKernel(ClipKernels::PowerCurve<6> {});
+        checkKernel(ClipKernels::PowerCurve<8> {});
+
+        for (auto n : { CurveTable::exponentFor(0), 1.5, CurveTable::exponentFor(50), 7.3 })
+            checkKernel(ClipKernels::GenericPowerCurve(n));
+
+        for (int exponentiation = 0; exponentiation < CurveTable::numCurves; ++exponentiation)
+        {
+            auto n = CurveTable::exponentFor(exponentiation);
+            auto input = sweep(n / (n - 1));
+            auto reference = referenceFor(input, n);
+
+            auto tier = [&] (CurveTable::Accuracy accuracy)
+            {
+                return measure(input, reference, [&] (auto isa, auto* data, int numSamples)
+                {
+                    curves.process(data, numSamples, exponentiation, accuracy, isa);
+                });
+            };
+
+            highError = juce::jmax(highError, tier(CurveTable::Accuracy::high));
+            fastError = juce::jmax(fastError, tier(CurveTable::Accuracy::fast));
+        }
+
+        // a quarter, half and three quarters of the way between each pair, on
+        // the lower curve's sweep as it has the larger threshold
+        for (int lower = 0; lower < CurveTable::numCurves - 1; ++lower)
+        {
+            auto nLower = CurveTable::exponentFor(lower);
+            auto nUpper = CurveTable::exponentFor(lower + 1);
+            auto input = sweep(nLower / (nLower - 1));
+            auto referenceLower = referenceFor(input, nLower);
+            auto referenceUpper = referenceFor(input, nUpper);
+
+            for (auto amount : { 0.25f, 0.5f, 0.75f })
+            {
+                std::vector<float> position (input.size(), (float) lower + amount);
+                std::vector<double> reference;
+
+                for (size_t i = 0; i < input.size(); ++i)
+                    reference.push_back(referenceLower[i] + amount * (referenceUpper[i] - referenceLower[i]));
+
+                auto morph = [&] (CurveTable::Accuracy accuracy)
+                {
+                    return measure(input, reference, [&] (auto isa, auto* data, int numSamples)
+                    {
+                        curves.processMorph(data, position.data(), numSamples, accuracy, isa);
+                    });
+                };
+
+                morphHighError = juce::jmax(morphHighError, morph(CurveTable::Accuracy::high));
+                morphFastError = juce::jmax(morphFastError, morph(CurveTable::Accuracy::fast));
+            }
+        }
+
+        auto report = [] (const char* name, double error, double limit)
+        {
+            std::cout << "kernels: " << name << " " << juce::String(error, 9) << " max error against the reference curve"
+                      << (error > limit ? ", over the limit of " + juce::String(limit) : juce::String()) << std::endl;
+
+            return error <= limit;
+        };
+
+        auto ok = report("clip kernels", kernelError, 1.0e-5);
+        ok = report("4-27 high tier", highError, 1.0e-5) && ok;
+        ok = report("4-27 fast tier", fastError, 1.0e-4) && ok;
+        ok = report("4-27 morph, high tier", morphHighError, 1.0e-5) && ok;
+        ok = report("4-27 morph, fast tier", morphFastError, 1.0e-4) && ok;
+        return ok;
+    }
+
+    /** Times every kernel in every variant this CPU can run, so the variants
+        can be compared: each curve in ClipKernels.h, the 4-27 curve tiers and
+        the gain and sum stages.
+    */
+    void benchmarkKernels (const Config& config, bool quick, const CurveTable& curves, Results& results)
+    {
+        auto numChannels = config.numChannels, numSamples = config.blockSize;
+
+        juce::AudioBuffer<float> source (numChannels, numSamples), buffer (source);
+        juce::Random random (1);
+        fillWithNoise(source, random);
+
+        std::vector<float> ramp ((size_t) numSamples), positions ((size_t) numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            ramp[(size_t) i] = 0.5f + 0.5f * (float) i / (float) numSamples;
+            positions[(size_t) i] = 50.0f + (float) i / (float) numSamples;
+        }
+
+        for (auto isa : KernelDispatch::allIsas)
+        {
+            if (! KernelDispatch::isSupported(isa))
+                continue;
+
+            // each kernel runs on the driven source, in place
+            auto run = [&] (const juce::String& stage, auto&& kernel)
+            {
+                results.add("kernels", stage + " " + KernelDispatch::getName(isa), config, measure(config, quick, [&]
+                {
+                    for (int channel = 0; channel < numChannels; ++channel)
+                    {
+                        juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel), source.getReadPointer(channel),
+                                                              3.0f, numSamples);
+                        kernel(channel, buffer.getWritePointer(channel));
+                    }
+                }));
+            };
+
+            auto runCurve = [&] (const juce::String& stage, const auto& curve)
+            {
+                run(stage, [&] (int, float* data) { ClipKernels::clip(isa, curve, data, numSamples); });
+            };
+
+            runCurve("power 2", ClipKernels::PowerCurve<2> {});
+            runCurve("power 3", ClipKernels::PowerCurve<3> {});
+            runCurve("power 4", ClipKernels::PowerCurve<4> {});
+            runCurve("power 5", ClipKernels::PowerCurve<5> {});
+            runCurve("power 6", ClipKernels::PowerCurve<6> {});
+            runCurve("power 8", ClipKernels::PowerCurve<8> {});
+            runCurve("power generic", ClipKernels::GenericPowerCurve(CurveTable::exponentFor(50)));
+
+            run("curve high", [&] (int, float* data) { curves.process(data, numSamples, 50, CurveTable::Accuracy::high, isa); });
+            run("curve fast", [&] (int, float* data) { curves.process(data, numSamples, 50, CurveTable::Accuracy::fast, isa); });
+
+            // what a block costs while Exponentiation ramps from 50 to 51
+            run("curve morph high", [&] (int, float* data) { curves.processMorph(data, positions.data(), numSamples, CurveTable::Accuracy::high, isa); });
+            run("curve morph fast", [&] (int, float* data) { curves.processMorph(data, positions.data(), numSamples, CurveTable::Accuracy::fast, isa); });
+
+            run("gain", [&] (int, float* data) { KernelDispatch::multiply(isa, data, ramp.data(), numSamples); });
+            run("sum", [&] (int channel, float* data) { KernelDispatch::add(isa, data, source.getReadPointer(channel), numSamples); });
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+
+    auto quick = args.contains("--quick");
+    auto plugins = Headless::getProcessorNames();
+    juce::File outputFile;
+
+    if (auto index = args.indexOf("--plugin"); index >= 0)
+        plugins = { args[index + 1] };
+
+    auto numInstances = 200;
+
+    if (auto index = args.indexOf("--instances"); index >= 0)
+        numInstances = juce::jmax(1, args[index + 1].getIntValue());
+
+    if (auto index = args.indexOf("--out"); index >= 0)
+        outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[index + 1]);
+
+    CurveTable curves;
+    curves.build();
+
+    // the same choice the processors make in prepareToPlay
+    auto isa = KernelDispatch::select();
+    juce::StringArray supported;
+
+    for (auto variant : KernelDispatch::allIsas)
+        if (KernelDispatch::isSupported(variant))
+            supported.add(KernelDispatch::getName(variant));
+
+    std::cout << "kernels: " << KernelDispatch::getName(isa) << " selected, this CPU runs "
+              << supported.joinIntoString(", ") << " (set OMNI_KERNELS to override)" << std::endl;
+
+    auto requested = KernelDispatch::getOverride();
+
+    if (requested.isNotEmpty() && ! requested.equalsIgnoreCase(KernelDispatch::getName(isa)))
+        std::cout << "kernels: OMNI_KERNELS=" << requested << " isn't supported here, ignored" << std::endl;
+
+    if (! kernelCheck(curves))
+    {
+        std::cerr << "Benchmark: a clip kernel or curve table doesn't match the reference curve" << std::endl;
+        return 1;
+    }
+
+    Results results;
+    results.setKernels(KernelDispatch::getName(isa));
+
+    for (auto& plugin : plugins)
+    {
+        if (Headless::createProcessor(plugin) == nullptr)
+        {
+            std::cerr << "Benchmark: unknown plugin " << plugin << std::endl;
+            return 1;
+        }
+
+        auto isSmartClip = plugin.equalsIgnoreCase("smartclip");
+
+        if (isSmartClip)
+        {
+            auto difference = limiterNullTest();
+            std::cout << "limiter null: " << juce::String(difference, 1) << " dB against juce::dsp::Compressor" << std::endl;
+
+            if (difference > -100.0)
+            {
+                std::cerr << "Benchmark: the limiter doesn't null against the compressor" << std::endl;
+                return 1;
+            }
+
+            // at the defaults, and at the mid settings the timings use
+            for (auto [drive, preserve] : { std::pair(0.0f, 0.0f), std::pair(6.0f, 64.0f) })
+            {
+                auto chainDifference = chainNullTest(drive, preserve);
+                std::cout << "chain null: " << juce::String(chainDifference, 1) << " dB against the juce::dsp chain it replaced, Drive "
+                          << drive << ", Preserve " << preserve << std::endl;
+
+                if (chainDifference > -100.0)
+                {
+                    std::cerr << "Benchmark: processBlock doesn't null against the juce::dsp chain it replaced" << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        // opening a session, once with the tables shared and once with a copy per instance
+        {
+            SharedTableStore::Stats shared, unshared;
+            auto sharedSeconds = instanceLoadTime(plugin, numInstances, true, shared);
+            auto unsharedSeconds = instanceLoadTime(plugin, numInstances, false, unshared);
+
+            std::cout << "instances: " << numInstances << " load in " << juce::String(sharedSeconds * 1000.0, 1)
+                      << " ms sharing tables, " << juce::String(unsharedSeconds * 1000.0, 1) << " ms with a copy each; "
+                      << shared.numTables << " shared tables of " << juce::String((double) shared.numBytes / 1024.0, 1)
+                      << " KB save " << juce::String((double) shared.numBytesSaved / 1024.0, 1) << " KB" << std::endl;
+        }
+
+        double fractionAsleep = 0.0;
+        int numMovedAsleep = 0;
+        auto sleepDifference = sleepNullTest(plugin, fractionAsleep, numMovedAsleep);
+        std::cout << "sleep null: " << juce::String(sleepDifference, 1) << " dB against a processor that never sleeps, asleep for "
+                  << juce::String(fractionAsleep * 100.0, 0) << "% of the blocks, parameters moved while asleep "
+                  << numMovedAsleep << " times" << std::endl;
+
+        if (sleepDifference > -100.0 || fractionAsleep <= 0.0 || numMovedAsleep == 0)
+        {
+            std::cerr << "Benchmark: sleeping through silence changes the output, or never happens" << std::endl;
+            return 1;
+        }
+
+        // mid settings, so the compressor and the curves are doing real work
+        juce::var parameters (new juce::DynamicObject());
+        parameters.getDynamicObject()->setProperty("Drive", 6.0f);
+        parameters.getDynamicObject()->setProperty(isSmartClip ? "Preserve" : "Exponentiation", isSmartClip ? 64.0f : 50.0f);
+
+        for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+        {
+            for (int blockSize = 16; blockSize <= 4096; blockSize *= 2)
+            {
+                for (int numChannels = 1; numChannels <= 2; ++numChannels)
+                {
+                    Config config { sampleRate, blockSize, numChannels };
+
+                    if (isSmartClip)
+                        benchmarkSmartClipStages(config, quick, isa, results);
+                    else
+                        benchmark427Stages(config, quick, curves, isa, results);
+
+                    benchmarkProcessor(plugin, "processBlock", config, quick, parameters, results);
+                    benchmarkProcessor<double>(plugin, "processBlock double", config, quick, parameters, results);
+                    benchmarkProcessor(plugin, "processBlock idle", config, quick, parameters, results, true);
+
+                    // the cost of every extra band, with each band's limiter working
+                    if (isSmartClip)
+                    {
+                        for (int numBands = 2; numBands <= 6; ++numBands)
+                        {
+                            juce::var multiband (new juce::DynamicObject());
+                            multiband.getDynamicObject()->setProperty("Drive", 6.0f);
+                            multiband.getDynamicObject()->setProperty("Multiband", 1.0f);
+                            multiband.getDynamicObject()->setProperty("Bands", numBands);
+
+                            for (int band = 1; band <= numBands; ++band)
+                                multiband.getDynamicObject()->setProperty("Preserve" + juce::String(band), 64.0f);
+
+                            benchmarkProcessor(plugin, "multiband " + juce::String(numBands), config, quick, multiband, results);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // the shared kernels once, they don't depend on the plugin or the rate
+    for (int blockSize = 16; blockSize <= 4096; blockSize *= 2)
+        benchmarkKernels({ 48000.0, blockSize, 2 }, quick, curves, results);
+
+    if (outputFile != juce::File())
+    {
+        if (! outputFile.replaceWithText(results.toJSON()))
+        {
+            std::cerr << "Benchmark: couldn't write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
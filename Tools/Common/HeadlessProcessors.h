@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    HeadlessProcessors.h
+
+    Creates and drives the plugin processors without a host, for the
+    command line tools in this folder.
+
+    The tools are JUCE console applications that compile both plugins'
+    PluginProcessor.cpp / PluginEditor.cpp (plus CurveTable.cpp for 4-27)
+    directly, with these preprocessor definitions:
+
+        OMNI_HEADLESS=1             leaves out the two createPluginFilter()s
+        JucePlugin_Name="OMNI"      normally provided by the plugin project
+        OMNI_STAGE_TIMING=1         per stage timings (StressTest needs this)
+
+    and the juce_audio_formats, juce_audio_processors, juce_audio_utils and
+    juce_dsp modules.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../SmartClip/PluginProcessor.h"
+#include "../../4-27/PluginProcessor.h"
+
+namespace Headless
+{
+    //==============================================================================
+    inline juce::StringArray getProcessorNames()
+    {
+        return { "smartclip", "4-27" };
+    }
+
+    /** Returns a new processor by name, or nullptr if the name isn't known. */
+    inline std::unique_ptr<juce::AudioProcessor> createProcessor (const juce::String& name)
+    {
+        if (name.equalsIgnoreCase("smartclip"))
+            return std::make_unique<OmniSmartClipAudioProcessor>();
+
+        if (name.equalsIgnoreCase("4-27") || name.equalsIgnoreCase("427"))
+            return std::make_unique<_427AudioProcessor>();
+
+        return nullptr;
+    }
+
+    //==============================================================================
+    /** Sets a parameter by its ID (e.g. "Drive") to a value in its own units. */
+    inline bool setParameter (juce::AudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        for (auto* parameter : processor.getParameters())
+        {
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            {
+                if (ranged->getParameterID().equalsIgnoreCase(parameterID))
+                {
+                    ranged->setValueNotifyingHost(ranged->convertTo0to1(value));
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /** Applies every property of a JSON object such as { "Drive": 6, "Preserve": 64 }. */
+    inline juce::Result setParameters (juce::AudioProcessor& processor, const juce::var& preset)
+    {
+        auto* object = preset.getDynamicObject();
+
+        if (object == nullptr)
+            return juce::Result::fail("preset is not a JSON object");
+
+        for (auto& property : object->getProperties())
+            if (! setParameter(processor, property.name.toString(), (float) property.value))
+                return juce::Result::fail("unknown parameter " + property.name.toString());
+
+        return juce::Result::ok();
+    }
+
+    /** The per stage timings of a processor's last block, and its ring of block
+        records, or nullptr for an unknown processor.
+    */
+    inline StageTimer* getStageTimer (juce::AudioProcessor& processor)
+    {
+        if (auto* smartClip = dynamic_cast<OmniSmartClipAudioProcessor*>(&processor))
+            return &smartClip->getStageTimer();
+
+        if (auto* fourTwentySeven = dynamic_cast<_427AudioProcessor*>(&processor))
+            return &fourTwentySeven->getStageTimer();
+
+        return nullptr;
+    }
+
+    /** Turns sleeping through silence (see ../../Shared/SilenceGate.h) on or off. */
+    inline void setSleepEnabled (juce::AudioProcessor& processor, bool shouldSleep)
+    {
+        if (auto* smartClip = dynamic_cast<OmniSmartClipAudioProcessor*>(&processor))
+            smartClip->setSleepEnabled(shouldSleep);
+
+        if (auto* fourTwentySeven = dynamic_cast<_427AudioProcessor*>(&processor))
+            fourTwentySeven->setSleepEnabled(shouldSleep);
+    }
+
+    /** Whether the processor skipped its last block, call it from the thread that ran it. */
+    inline bool isAsleep (juce::AudioProcessor& processor)
+    {
+        if (auto* smartClip = dynamic_cast<OmniSmartClipAudioProcessor*>(&processor))
+            return smartClip->isAsleep();
+
+        if (auto* fourTwentySeven = dynamic_cast<_427AudioProcessor*>(&processor))
+            return fourTwentySeven->isAsleep();
+
+        return false;
+    }
+
+    /** Turns on what an open editor would, the level meters and SmartClip's
+        spectrum analyzer, so that the audio thread feeds them. Message thread.
+    */
+    inline void setEditorOpen (juce::AudioProcessor& processor, bool isOpen)
+    {
+        if (auto* smartClip = dynamic_cast<OmniSmartClipAudioProcessor*>(&processor))
+        {
+            smartClip->getMeters().setActive(isOpen);
+            smartClip->getAnalyzer().setActive(isOpen);
+        }
+
+        if (auto* fourTwentySeven = dynamic_cast<_427AudioProcessor*>(&processor))
+            fourTwentySeven->getMeters().setActive(isOpen);
+    }
+
+    //==============================================================================
+    /** Sets a matching input/output layout and the precision processBlock will
+        be called with, then calls prepareToPlay.
+    */
+    inline bool prepare (juce::AudioProcessor& processor, int numChannels, double sampleRate, int blockSize,
+                         juce::AudioProcessor::ProcessingPrecision precision = juce::AudioProcessor::singlePrecision)
+    {
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+
+        if (! processor.setBusesLayout(layout))
+            return false;
+
+        if (precision == juce::AudioProcessor::doublePrecision && ! processor.supportsDoublePrecisionProcessing())
+            return false;
+
+        processor.setProcessingPrecision(precision);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        return true;
+    }
+}
@@ -0,0 +1,454 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Checks that processBlock never allocates, frees or takes a lock, in
+    either plugin.
+
+    The heap and the mutexes are interposed for the whole process:
+
+        operator new / delete   every form, on every platform
+        malloc and friends      Linux with glibc, forwarded to __libc_malloc...
+        pthread_mutex_lock      Linux with glibc, forwarded to __pthread_mutex_lock,
+                                which catches juce::CriticalSection, std::mutex
+                                and juce::WaitableEvent
+
+    A call counts as a hit while a processBlock is running, either on the
+    thread that called it or on a SmartClip channel worker running one of
+    its groups (see ../../Shared/ChannelWorkerPool.h). Anything else, the
+    parameter changes between blocks, the analyzer's own thread, a worker
+    spinning or parked, is left alone.
+
+    Each plugin is run in float and double, with 2 channels and with 8 (so
+    SmartClip splits them over its workers), and with and without the
+    meters and spectrum analyzer an open editor would turn on. Every run is
+    prepared for --prepared samples and then sent blocks of anywhere from 1
+    to --max-block samples, larger than it was prepared for too, with noise,
+    silence it can fall asleep on, and random automation of every parameter
+    between blocks.
+
+    The run fails on the first configuration with any hit, and prints where
+    the first one came from (build with -rdynamic for the function names).
+
+    Usage:
+        RealtimeCheck [--plugin smartclip|4-27] [--blocks <n>] [--rate <Hz>]
+                      [--prepared <samples>] [--max-block <samples>] [--seed <n>]
+
+    See ../Common/HeadlessProcessors.h for how to build the tools.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <new>
+#include "../Common/HeadlessProcessors.h"
+
+#if JUCE_LINUX && defined (__GLIBC__)
+ #define OMNI_INTERPOSE_LIBC 1
+ #include <pthread.h>
+ #include <execinfo.h>
+#endif
+
+namespace RealtimeCheck
+{
+    //==============================================================================
+    enum Kind { allocation, deallocation, lock, numKinds };
+
+    std::atomic<bool> armed { false };
+    thread_local bool onRenderThread = false;
+    thread_local bool insideHit = false;
+
+    std::array<std::atomic<juce::int64>, numKinds> counts {};
+    std::atomic<juce::int64> currentBlock { 0 };
+
+    // where the first hit came from, kept without allocating
+    std::atomic<bool> firstRecorded { false };
+    Kind firstKind = allocation;
+    juce::int64 firstBlock = 0;
+    std::array<void*, 48> firstTrace {};
+    int firstTraceDepth = 0;
+
+    const char* getName (Kind kind)
+    {
+        return kind == allocation ? "allocation" : kind == deallocation ? "free" : "lock";
+    }
+
+    /** Called from every interposed function, before it does anything. */
+    void hit (Kind kind) noexcept
+    {
+        if (! armed.load(std::memory_order_relaxed) || insideHit)
+            return;
+
+        if (! (onRenderThread || ChannelWorkerPool::isRunningGroup()))
+            return;
+
+        insideHit = true;
+        counts[(size_t) kind].fetch_add(1, std::memory_order_relaxed);
+
+        if (! firstRecorded.exchange(true))
+        {
+            firstKind = kind;
+            firstBlock = currentBlock.load();
+
+           #if OMNI_INTERPOSE_LIBC
+            firstTraceDepth = backtrace(firstTrace.data(), (int) firstTrace.size());
+           #endif
+        }
+
+        insideHit = false;
+    }
+
+    void resetCounts()
+    {
+        for (auto& count : counts)
+            count = 0;
+
+        firstRecorded = false;
+        firstTraceDepth = 0;
+    }
+
+    /** Marks the calling thread as the audio thread for one processBlock. */
+    struct ScopedRenderPath
+    {
+        ScopedRenderPath() noexcept     { onRenderThread = true; armed = true; }
+        ~ScopedRenderPath() noexcept    { armed = false; onRenderThread = false; }
+    };
+
+    //==============================================================================
+    // the allocator underneath, which is never interposed
+   #if OMNI_INTERPOSE_LIBC
+    extern "C" void* __libc_malloc (size_t);
+    extern "C" void* __libc_calloc (size_t, size_t);
+    extern "C" void* __libc_realloc (void*, size_t);
+    extern "C" void* __libc_memalign (size_t, size_t);
+    extern "C" void __libc_free (void*);
+
+    void* rawAllocate (size_t size) noexcept                    { return __libc_malloc(size); }
+    void* rawAllocateAligned (size_t size, size_t alignment)    { return __libc_memalign(alignment, size); }
+    void rawFree (void* p) noexcept                             { __libc_free(p); }
+    void rawFreeAligned (void* p) noexcept                      { __libc_free(p); }
+   #elif JUCE_WINDOWS
+    void* rawAllocate (size_t size) noexcept                    { return std::malloc(size); }
+    void* rawAllocateAligned (size_t size, size_t alignment)    { return _aligned_malloc(size, alignment); }
+    void rawFree (void* p) noexcept                             { std::free(p); }
+    void rawFreeAligned (void* p) noexcept                      { _aligned_free(p); }
+   #else
+    void* rawAllocate (size_t size) noexcept                    { return std::malloc(size); }
+    void rawFree (void* p) noexcept                             { std::free(p); }
+    void rawFreeAligned (void* p) noexcept                      { std::free(p); }
+
+    void* rawAllocateAligned (size_t size, size_t alignment)
+    {
+        void* p = nullptr;
+        return posix_memalign(&p, juce::jmax(alignment, sizeof (void*)), size) == 0 ? p : nullptr;
+    }
+   #endif
+
+    void* allocate (size_t size)
+    {
+        hit(allocation);
+
+        if (auto* p = rawAllocate(juce::jmax((size_t) 1, size)))
+            return p;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned (size_t size, std::align_val_t alignment)
+    {
+        hit(allocation);
+
+        if (auto* p = rawAllocateAligned(juce::jmax((size_t) 1, size), (size_t) alignment))
+            return p;
+
+        throw std::bad_alloc();
+    }
+
+    void release (void* p) noexcept
+    {
+        if (p == nullptr)
+            return;
+
+        hit(deallocation);
+        rawFree(p);
+    }
+
+    void releaseAligned (void* p) noexcept
+    {
+        if (p == nullptr)
+            return;
+
+        hit(deallocation);
+        rawFreeAligned(p);
+    }
+}
+
+//==============================================================================
+// the replaceable global operators, which the whole program links against
+void* operator new (size_t size)                                        { return RealtimeCheck::allocate(size); }
+void* operator new[] (size_t size)                                      { return RealtimeCheck::allocate(size); }
+void* operator new (size_t size, std::align_val_t alignment)            { return RealtimeCheck::allocateAligned(size, alignment); }
+void* operator new[] (size_t size, std::align_val_t alignment)          { return RealtimeCheck::allocateAligned(size, alignment); }
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept
+{
+    try { return RealtimeCheck::allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept
+{
+    try { return RealtimeCheck::allocate(size); } catch (...) { return nullptr; }
+}
+
+void operator delete (void* p) noexcept                                 { RealtimeCheck::release(p); }
+void operator delete[] (void* p) noexcept                               { RealtimeCheck::release(p); }
+void operator delete (void* p, size_t) noexcept                         { RealtimeCheck::release(p); }
+void operator delete[] (void* p, size_t) noexcept                       { RealtimeCheck::release(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept          { RealtimeCheck::release(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept        { RealtimeCheck::release(p); }
+void operator delete (void* p, std::align_val_t) noexcept               { RealtimeCheck::releaseAligned(p); }
+void operator delete[] (void* p, std::align_val_t) noexcept             { RealtimeCheck::releaseAligned(p); }
+void operator delete (void* p, size_t, std::align_val_t) noexcept       { RealtimeCheck::releaseAligned(p); }
+void operator delete[] (void* p, size_t, std::align_val_t) noexcept     { RealtimeCheck::releaseAligned(p); }
+
+#if OMNI_INTERPOSE_LIBC
+//==============================================================================
+// glibc lets a program replace malloc, and its own copies stay reachable
+// under these names, so nothing has to be looked up with dlsym (which
+// allocates and locks) before the first call
+extern "C"
+{
+    int __pthread_mutex_lock (pthread_mutex_t*);
+    int __pthread_mutex_trylock (pthread_mutex_t*);
+
+    void* malloc (size_t size)
+    {
+        RealtimeCheck::hit(RealtimeCheck::allocation);
+        return RealtimeCheck::__libc_malloc(size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        RealtimeCheck::hit(RealtimeCheck::allocation);
+        return RealtimeCheck::__libc_calloc(count, size);
+    }
+
+    void* realloc (void* p, size_t size)
+    {
+        RealtimeCheck::hit(RealtimeCheck::allocation);
+        return RealtimeCheck::__libc_realloc(p, size);
+    }
+
+    void* memalign (size_t alignment, size_t size)
+    {
+        RealtimeCheck::hit(RealtimeCheck::allocation);
+        return RealtimeCheck::__libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size)
+    {
+        RealtimeCheck::hit(RealtimeCheck::allocation);
+        return RealtimeCheck::__libc_memalign(alignment, size);
+    }
+
+    int posix_memalign (void** result, size_t alignment, size_t size)
+    {
+        RealtimeCheck::hit(RealtimeCheck::allocation);
+        auto* p = RealtimeCheck::__libc_memalign(alignment, size);
+
+        if (p == nullptr)
+            return ENOMEM;
+
+        *result = p;
+        return 0;
+    }
+
+    void free (void* p)
+    {
+        if (p != nullptr)
+            RealtimeCheck::hit(RealtimeCheck::deallocation);
+
+        RealtimeCheck::__libc_free(p);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        RealtimeCheck::hit(RealtimeCheck::lock);
+        return __pthread_mutex_lock(mutex);
+    }
+
+    int pthread_mutex_trylock (pthread_mutex_t* mutex)
+    {
+        RealtimeCheck::hit(RealtimeCheck::lock);
+        return __pthread_mutex_trylock(mutex);
+    }
+}
+#endif
+
+namespace
+{
+    //==============================================================================
+    struct Settings
+    {
+        juce::StringArray plugins = Headless::getProcessorNames();
+        juce::int64 numBlocks = 20000;
+        double sampleRate = 48000.0;
+        int preparedBlockSize = 512;
+        int maxBlockSize = 2048;
+        juce::int64 seed = 1;
+    };
+
+    /** Noise bursts at random levels with stretches of digital silence between
+        them, long enough for the processors to fall asleep and wake again.
+    */
+    template <typename Sample>
+    void fillInput (juce::AudioBuffer<Sample>& buffer, juce::Random& random, int& silenceRemaining, float& level)
+    {
+        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        {
+            if (--silenceRemaining == 0)
+                level = juce::Decibels::decibelsToGain(-30.0f + 36.0f * random.nextFloat());
+            else if (silenceRemaining < -48000 && random.nextInt(20000) == 0)
+            {
+                silenceRemaining = 1 + random.nextInt(96000);
+                level = 0.0f;
+            }
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.setSample(channel, sample, (Sample) ((random.nextFloat() * 2.0f - 1.0f) * level));
+        }
+    }
+
+    /** Runs one configuration and returns false if anything was hit. */
+    template <typename Sample>
+    bool run (const juce::String& plugin, const Settings& settings, int numChannels, bool editorOpen)
+    {
+        auto isDouble = std::is_same_v<Sample, double>;
+        auto name = plugin + (isDouble ? " double, " : " float, ") + juce::String(numChannels) + " channels, editor "
+                  + (editorOpen ? "open" : "closed");
+
+        auto processor = Headless::createProcessor(plugin);
+
+        if (! Headless::prepare(*processor, numChannels, settings.sampleRate, settings.preparedBlockSize,
+                                isDouble ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision))
+        {
+            std::cout << name << ": not supported, skipped" << std::endl;
+            return true;
+        }
+
+        Headless::setEditorOpen(*processor, editorOpen);
+
+        auto& parameters = processor->getParameters();
+        juce::AudioBuffer<Sample> buffer (numChannels, settings.maxBlockSize);
+        juce::MidiBuffer midi;
+        juce::Random random (settings.seed);
+        int silenceRemaining = 1;
+        float level = 0.0f;
+
+        RealtimeCheck::resetCounts();
+
+        for (juce::int64 index = 0; index < settings.numBlocks; ++index)
+        {
+            // spread over octaves so small blocks are well covered, up to past the prepared size
+            auto blockSize = juce::jlimit(1, settings.maxBlockSize,
+                                          (int) std::exp2(random.nextDouble() * std::log2((double) settings.maxBlockSize + 1.0)));
+
+            buffer.setSize(numChannels, blockSize, false, false, true);
+            fillInput(buffer, random, silenceRemaining, level);
+
+            // automation lands between blocks, outside the checked region
+            if (random.nextInt(8) == 0)
+                parameters[random.nextInt(parameters.size())]->setValueNotifyingHost(random.nextFloat());
+
+            RealtimeCheck::currentBlock = index;
+
+            {
+                RealtimeCheck::ScopedRenderPath renderPath;
+                processor->processBlock(buffer, midi);
+            }
+        }
+
+        Headless::setEditorOpen(*processor, false);
+        processor->releaseResources();
+
+        auto allocations = RealtimeCheck::counts[RealtimeCheck::allocation].load();
+        auto frees = RealtimeCheck::counts[RealtimeCheck::deallocation].load();
+        auto locks = RealtimeCheck::counts[RealtimeCheck::lock].load();
+
+        std::cout << name << ": " << settings.numBlocks << " blocks, " << allocations << " allocations, "
+                  << frees << " frees, " << locks << " locks" << std::endl;
+
+        if (allocations + frees + locks == 0)
+            return true;
+
+        std::cout << "  first: a " << RealtimeCheck::getName(RealtimeCheck::firstKind) << " in block "
+                  << RealtimeCheck::firstBlock << std::endl;
+
+       #if OMNI_INTERPOSE_LIBC
+        std::cout.flush();
+        backtrace_symbols_fd(RealtimeCheck::firstTrace.data(), RealtimeCheck::firstTraceDepth, 1);
+       #endif
+
+        return false;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+
+    Settings settings;
+
+    auto valueOf = [&args] (const char* option, const juce::String& fallback)
+    {
+        auto index = args.indexOf(option);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1] : fallback;
+    };
+
+    if (args.contains("--plugin"))
+        settings.plugins = { valueOf("--plugin", {}) };
+
+    settings.numBlocks = juce::jmax((juce::int64) 1, valueOf("--blocks", "20000").getLargeIntValue());
+    settings.sampleRate = juce::jlimit(8000.0, 768000.0, valueOf("--rate", "48000").getDoubleValue());
+    settings.preparedBlockSize = juce::jlimit(1, 65536, valueOf("--prepared", "512").getIntValue());
+    settings.maxBlockSize = juce::jlimit(1, 65536, valueOf("--max-block", "2048").getIntValue());
+    settings.seed = valueOf("--seed", "1").getLargeIntValue();
+
+   #if OMNI_INTERPOSE_LIBC
+    // the first backtrace() loads the unwinder, which allocates, so get it done now
+    std::array<void*, 4> warmUp;
+    backtrace(warmUp.data(), (int) warmUp.size());
+   #else
+    std::cout << "only operator new and delete are interposed on this platform, not malloc or mutexes" << std::endl;
+   #endif
+
+    for (auto& plugin : settings.plugins)
+    {
+        if (Headless::createProcessor(plugin) == nullptr)
+        {
+            std::cerr << "RealtimeCheck: unknown plugin " << plugin << std::endl;
+            return 1;
+        }
+
+        for (auto numChannels : { 2, 8 })
+        {
+            for (auto editorOpen : { false, true })
+            {
+                if (! run<float>(plugin, settings, numChannels, editorOpen) || ! run<double>(plugin, settings, numChannels, editorOpen))
+                {
+                    std::cerr << "RealtimeCheck: " << plugin << " allocates or locks in processBlock" << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Worst case processBlock latency and jitter harness for SmartClip and 4-27.
+
+    Drives a headless processor for millions of blocks with random block
+    sizes, random parameter automation and input made of decaying tails that
+    run down into the denormal range, so the crossover and limiter state
+    spends time there too. Every call is timed into a histogram and the
+    p50 / p99 / p99.9 / max latency is reported, both in microseconds and as
+    a fraction of the block's deadline (its length in real time).
+
+    The slowest calls are kept along with the processor's per stage timings
+    for that block, so every outlier shows which stage it spent its time in.
+    Build with OMNI_STAGE_TIMING=1 for the stage breakdown.
+
+    With OMNI_STAGE_TIMING=1 a second thread also drains every block record
+    the processor publishes (see ../../Shared/StageTimer.h), as an editor
+    or logger would, and sums up the denormals and gain reduction they saw.
+    --trace writes each record to a file as one line of JSON.
+
+    Usage:
+        StressTest [--plugin smartclip|4-27] [--blocks <n>] [--rate <Hz>]
+                   [--max-block <samples>] [--flag <fraction of deadline>]
+                   [--top <n>] [--seed <n>] [--trace <records.jsonl>]
+
+    See ../Common/HeadlessProcessors.h for how to build the tools.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <thread>
+#include "../Common/HeadlessProcessors.h"
+
+namespace
+{
+    //==============================================================================
+    /** Log-linear histogram, 16 buckets per octave, so any percentile read back
+        from it is within about 6% of the true value.
+    */
+    class Histogram
+    {
+    public:
+        void add (double value) noexcept
+        {
+            ++counts[(size_t) bucketFor(value)];
+            ++numValues;
+            maxValue = juce::jmax(maxValue, value);
+        }
+
+        /** Upper edge of the bucket holding the given percentile (0 - 100). */
+        double getPercentile (double percentile) const noexcept
+        {
+            auto target = (juce::int64) std::ceil(numValues * percentile / 100.0);
+            juce::int64 seen = 0;
+
+            for (int bucket = 0; bucket < numBuckets; ++bucket)
+            {
+                seen += counts[(size_t) bucket];
+
+                if (seen >= target && seen > 0)
+                    return juce::jmin(upperEdgeOf(bucket), maxValue);
+            }
+
+            return maxValue;
+        }
+
+        double getMax() const noexcept              { return maxValue; }
+        juce::int64 getNumValues() const noexcept   { return numValues; }
+
+    private:
+        static constexpr int subBuckets = 16, numOctaves = 48, numBuckets = subBuckets * numOctaves;
+
+        static int bucketFor (double value) noexcept
+        {
+            if (value < 1.0)
+                return 0;
+
+            int octave;
+            auto mantissa = std::frexp(value, &octave);      // value = mantissa * 2^octave, mantissa in [0.5, 1)
+            auto sub = (int) ((mantissa * 2.0 - 1.0) * subBuckets);
+
+            return juce::jlimit(0, numBuckets - 1, (octave - 1) * subBuckets + sub);
+        }
+
+        static double upperEdgeOf (int bucket) noexcept
+        {
+            auto octave = bucket / subBuckets, sub = bucket % subBuckets;
+            return std::ldexp(1.0 + (sub + 1) / (double) subBuckets, octave);
+        }
+
+        std::array<juce::int64, numBuckets> counts {};
+        juce::int64 numValues = 0;
+        double maxValue = 0.0;
+    };
+
+    //==============================================================================
+    /** Bursts of low frequency noise that decay exponentially to around 1e-40,
+        well into the denormal range, followed by a stretch of digital silence.
+    */
+    class TailGenerator
+    {
+    public:
+        TailGenerator (double rate, juce::int64 seed) : sampleRate (rate), random (seed) {}
+
+        void fill (juce::AudioBuffer<float>& buffer) noexcept
+        {
+            for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+            {
+                if (envelope < 1.0e-40 && --silenceRemaining <= 0)
+                    startBurst();
+
+                // one pole lowpassed noise, mostly below the 140 Hz split
+                lowpassed += 0.02f * ((random.nextFloat() * 2.0f - 1.0f) - lowpassed);
+                auto value = (float) (envelope * lowpassed * 8.0);
+                envelope *= decay;
+
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    buffer.setSample(channel, sample, value);
+            }
+        }
+
+    private:
+        void startBurst() noexcept
+        {
+            envelope = 0.1 + 0.9 * random.nextDouble();
+
+            auto decaySeconds = 0.2 + 3.0 * random.nextDouble();
+            decay = std::exp(std::log(1.0e-41 / envelope) / (decaySeconds * sampleRate));
+
+            silenceRemaining = random.nextInt((int) sampleRate);
+        }
+
+        double sampleRate;
+        juce::Random random;
+        double envelope = 0.0, decay = 0.0;
+        float lowpassed = 0.0f;
+        int silenceRemaining = 0;
+    };
+
+    //==============================================================================
+    struct Call
+    {
+        juce::int64 index = 0;
+        int blockSize = 0;
+        double nanoseconds = 0.0, load = 0.0;
+        std::array<juce::int64, StageTimer::maxStages> stageTicks {};
+    };
+
+    struct Settings
+    {
+        juce::StringArray plugins = Headless::getProcessorNames();
+        juce::int64 numBlocks = 2000000;
+        double sampleRate = 48000.0;
+        int maxBlockSize = 1024;
+        double flagLoad = 0.1;
+        int numOutliers = 20;
+        juce::int64 seed = 1;
+        juce::File traceFile;
+    };
+
+    //==============================================================================
+    /** Drains a processor's block records on its own thread until stopped, the
+        way an editor or a logger would, optionally writing them out as JSON lines.
+    */
+    class RecordReader
+    {
+    public:
+        RecordReader (StageTimer& t, const juce::String& pluginName, const juce::File& traceFile)
+            : timer (t), plugin (pluginName)
+        {
+            if (traceFile != juce::File())
+            {
+                trace = std::make_unique<juce::FileOutputStream>(traceFile);
+
+                if (! trace->openedOk())
+                    trace.reset();
+            }
+
+            thread = std::thread([this]
+            {
+                while (running.load())
+                    if (drain() == 0)
+                        std::this_thread::yield();
+
+                drain();
+            });
+        }
+
+        ~RecordReader()     { stop(); }
+
+        /** Reads whatever is left, then stops the thread. */
+        void stop()
+        {
+            running = false;
+
+            if (thread.joinable())
+                thread.join();
+        }
+
+        void print() const
+        {
+            std::cout << "  " << numRecords << " block records read, " << timer.getNumDropped()
+                      << " dropped while the reader was behind, " << numDenormals << " denormals" << std::endl;
+
+            if (numGainReductions > 0)
+            {
+                std::cout << "  most gain reduction per limiter:";
+
+                for (int index = 0; index < numGainReductions; ++index)
+                    std::cout << " " << juce::String(maxGainReduction[(size_t) index], 1);
+
+                std::cout << " dB" << std::endl;
+            }
+        }
+
+    private:
+        int drain()
+        {
+            return timer.drain([this] (const StageTimer::Record& record)
+            {
+                ++numRecords;
+                numDenormals += record.denormals;
+                numGainReductions = juce::jmax(numGainReductions, record.numGainReductions);
+
+                for (int index = 0; index < record.numGainReductions; ++index)
+                    maxGainReduction[(size_t) index] = juce::jmax(maxGainReduction[(size_t) index], record.gainReduction[(size_t) index]);
+
+                if (trace != nullptr)
+                {
+                    auto object = timer.toVar(record);
+                    object.getDynamicObject()->setProperty("plugin", plugin);
+                    *trace << juce::JSON::toString(object, true) << "\n";
+                }
+            });
+        }
+
+        StageTimer& timer;
+        juce::String plugin;
+        std::unique_ptr<juce::FileOutputStream> trace;
+
+        juce::int64 numRecords = 0, numDenormals = 0;
+        int numGainReductions = 0;
+        std::array<float, StageTimer::maxGainReductions> maxGainReduction {};
+
+        std::atomic<bool> running { true };
+        std::thread thread;
+    };
+
+    //==============================================================================
+    void run (const juce::String& plugin, const Settings& settings)
+    {
+        auto processor = Headless::createProcessor(plugin);
+        constexpr int numChannels = 2;
+
+        if (! Headless::prepare(*processor, numChannels, settings.sampleRate, settings.maxBlockSize))
+            return;
+
+        auto* stageTimer = Headless::getStageTimer(*processor);
+        auto& parameters = processor->getParameters();
+
+        juce::AudioBuffer<float> buffer (numChannels, settings.maxBlockSize);
+        juce::MidiBuffer midi;
+        juce::Random random (settings.seed);
+        TailGenerator input (settings.sampleRate, settings.seed);
+
+        Histogram nanoseconds, load;
+        std::vector<Call> outliers;
+        juce::int64 numFlagged = 0, numMissed = 0;
+        const juce::int64 numWarmUpBlocks = 1000;
+
+        std::unique_ptr<RecordReader> reader;
+
+        if (stageTimer != nullptr && StageTimer::isEnabled())
+            reader = std::make_unique<RecordReader>(*stageTimer, plugin, settings.traceFile);
+
+        for (juce::int64 index = 0; index < settings.numBlocks + numWarmUpBlocks; ++index)
+        {
+            // block sizes spread evenly over octaves, so small blocks are well covered
+            auto blockSize = juce::jlimit(1, settings.maxBlockSize,
+                                          (int) std::exp2(random.nextDouble() * std::log2((double) settings.maxBlockSize)));
+
+            buffer.setSize(numChannels, blockSize, false, false, true);
+            input.fill(buffer);
+
+            // automation, as a host would send it from the audio thread
+            if (random.nextInt(16) == 0)
+                parameters[random.nextInt(parameters.size())]->setValueNotifyingHost(random.nextFloat());
+
+            auto start = juce::Time::getHighResolutionTicks();
+            processor->processBlock(buffer, midi);
+            auto elapsed = juce::Time::getHighResolutionTicks() - start;
+
+            if (index < numWarmUpBlocks)
+                continue;
+
+            Call call;
+            call.index = index - numWarmUpBlocks;
+            call.blockSize = blockSize;
+            call.nanoseconds = juce::Time::highResolutionTicksToSeconds(elapsed) * 1.0e9;
+            call.load = call.nanoseconds * 1.0e-9 / (blockSize / settings.sampleRate);
+
+            nanoseconds.add(call.nanoseconds);
+            load.add(call.load * 1.0e6);   // in parts per million of the deadline
+
+            numFlagged += call.load > settings.flagLoad ? 1 : 0;
+            numMissed += call.load > 1.0 ? 1 : 0;
+
+            // keeps the slowest calls, sorted slowest first, none with --top 0
+            if (settings.numOutliers > 0
+                 && ((int) outliers.size() < settings.numOutliers || call.nanoseconds > outliers.back().nanoseconds))
+            {
+                if (stageTimer != nullptr)
+                    for (int stage = 0; stage < stageTimer->getNumStages(); ++stage)
+                        call.stageTicks[(size_t) stage] = stageTimer->getTicks(stage);
+
+                auto position = std::upper_bound(outliers.begin(), outliers.end(), call,
+                                                 [] (const Call& a, const Call& b) { return a.nanoseconds > b.nanoseconds; });
+                outliers.insert(position, call);
+
+                if ((int) outliers.size() > settings.numOutliers)
+                    outliers.pop_back();
+            }
+        }
+
+        processor->releaseResources();
+
+        // everything the reader counted is in once it has stopped
+        if (reader != nullptr)
+            reader->stop();
+        //==============================================================================
+        auto microseconds = [] (double ns) { return juce::String(ns * 1.0e-3, 2) + " us"; };
+        auto percent = [] (double ppm) { return juce::String(ppm * 1.0e-4, 3) + " %"; };
+
+        std::cout << std::endl << plugin << ": " << nanoseconds.getNumValues() << " blocks at "
+                  << settings.sampleRate << " Hz, 1 - " << settings.maxBlockSize << " samples" << std::endl;
+
+        const std::pair<const char*, double> percentiles[] = { { "  p50", 50.0 }, { "  p99", 99.0 }, { "  p99.9", 99.9 } };
+
+        for (auto& p : percentiles)
+            std::cout << juce::String(p.first).paddedRight(' ', 10)
+                      << microseconds(nanoseconds.getPercentile(p.second)).paddedLeft(' ', 12)
+                      << percent(load.getPercentile(p.second)).paddedLeft(' ', 12) << " of deadline" << std::endl;
+
+        std::cout << juce::String("  max").paddedRight(' ', 10) << microseconds(nanoseconds.getMax()).paddedLeft(' ', 12)
+                  << percent(load.getMax()).paddedLeft(' ', 12) << " of deadline" << std::endl;
+
+        std::cout << "  " << numFlagged << " calls over " << settings.flagLoad * 100.0 << " % of their deadline, "
+                  << numMissed << " over 100 %" << std::endl;
+
+        if (reader != nullptr)
+            reader->print();
+
+        std::cout << std::endl;
+
+        std::cout << "  slowest calls:" << std::endl;
+
+        for (auto& call : outliers)
+        {
+            juce::String line ("    #" + juce::String(call.index).paddedRight(' ', 10)
+                               + juce::String(call.blockSize).paddedLeft(' ', 5) + " samples"
+                               + microseconds(call.nanoseconds).paddedLeft(' ', 12)
+                               + percent(call.load * 1.0e6).paddedLeft(' ', 10));
+
+            if (stageTimer != nullptr && StageTimer::isEnabled())
+            {
+                juce::int64 total = 0;
+                int slowest = 0;
+
+                for (int stage = 0; stage < stageTimer->getNumStages(); ++stage)
+                {
+                    total += call.stageTicks[(size_t) stage];
+
+                    if (call.stageTicks[(size_t) stage] > call.stageTicks[(size_t) slowest])
+                        slowest = stage;
+                }
+
+                line << "   mostly " << stageTimer->getStageName(slowest) << " (";
+
+                for (int stage = 0; stage < stageTimer->getNumStages(); ++stage)
+                    line << (stage > 0 ? ", " : "") << stageTimer->getStageName(stage) << " "
+                         << juce::roundToInt(100.0 * (double) call.stageTicks[(size_t) stage] / (double) juce::jmax((juce::int64) 1, total))
+                         << "%";
+
+                line << ")";
+            }
+
+            std::cout << line << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+
+    Settings settings;
+
+    auto valueOf = [&args] (const char* option, const juce::String& fallback)
+    {
+        auto index = args.indexOf(option);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1] : fallback;
+    };
+
+    if (args.contains("--plugin"))
+        settings.plugins = { valueOf("--plugin", {}) };
+
+    settings.numBlocks = juce::jmax((juce::int64) 1, valueOf("--blocks", "2000000").getLargeIntValue());
+    settings.sampleRate = juce::jlimit(8000.0, 768000.0, valueOf("--rate", "48000").getDoubleValue());
+    settings.maxBlockSize = juce::jlimit(1, 65536, valueOf("--max-block", "1024").getIntValue());
+    settings.flagLoad = juce::jmax(0.0, valueOf("--flag", "0.1").getDoubleValue());
+    settings.numOutliers = juce::jmax(0, valueOf("--top", "20").getIntValue());
+    settings.seed = valueOf("--seed", "1").getLargeIntValue();
+
+    if (args.contains("--trace"))
+    {
+        settings.traceFile = juce::File::getCurrentWorkingDirectory().getChildFile(valueOf("--trace", {}));
+        settings.traceFile.deleteFile();
+
+        if (! StageTimer::isEnabled())
+            std::cout << "built without OMNI_STAGE_TIMING, --trace has nothing to write" << std::endl;
+    }
+
+    if (! StageTimer::isEnabled())
+        std::cout << "built without OMNI_STAGE_TIMING, outliers won't show a stage breakdown" << std::endl;
+
+    for (auto& plugin : settings.plugins)
+    {
+        if (Headless::createProcessor(plugin) == nullptr)
+        {
+            std::cerr << "StressTest: unknown plugin " << plugin << std::endl;
+            return 1;
+        }
+
+        run(plugin, settings);
+    }
+
+    return 0;
+}